@@ -0,0 +1,11 @@
+// Per-CPU statistics, from cpustats(). Times are in cycles
+// of the time CSR (see rusage.h).
+struct cpustat {
+  int online;         // Has it started scheduling?
+  int nrunnable;      // Processes waiting on its run queue
+  int nswitch;        // Processes it has switched to
+  int nmigrated;      // Processes it has pulled off other cpus' queues
+  uint64 busy;        // Running processes
+  uint64 idle;        // Waiting for an interrupt with nothing to run
+  uint64 elapsed;     // Since it came online
+};
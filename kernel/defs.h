@@ -1,9 +1,15 @@
 struct buf;
 struct context;
+struct cpu;
 struct file;
 struct inode;
 struct pipe;
 struct proc;
+struct rbnode;
+struct rbroot;
+struct rusage;
+struct cpustat;
+struct kmemstat;
 struct spinlock;
 struct sleeplock;
 struct stat;
@@ -24,6 +30,7 @@ void            consputc(int);
 
 // exec.c
 int             exec(char*, char**);
+int             execproc(struct proc*, char*, char**);
 
 // file.c
 struct file*    filealloc(void);
@@ -62,8 +69,12 @@ void            ramdiskrw(struct buf*);
 // kalloc.c
 void*           kalloc(void);
 void            kfree(void *);
+void            kfreepage(void *);
 void            kinit(void);
 void            incRef(uint64 pa);  
+int             getRef(uint64 pa);
+int             decRef(uint64 pa);
+void            kmemstats(struct kmemstat*);
 
 // log.c
 void            initlog(int, struct superblock*);
@@ -86,6 +97,7 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
+int             spawn(char*, char**, struct file**);
 int             growproc(int);
 void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
@@ -102,18 +114,60 @@ void            sched(void);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(uint64);
-int             waitx(uint64, uint*, uint*);
+int             waitx(uint64, uint*, uint*, struct rusage*);
+int             getrusage(int, struct rusage*);
 void            wakeup(void*);
 void            yield(void);
+void            sched_yield(void);
+int             yieldto(int);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
-void            update_time(void);
 int             rand(void);
 void            srand(unsigned int);
 struct proc*    getProc(int pid);
 int             getDP(struct proc *p);
 
+// rbtree.c
+void            rb_insert(struct rbroot*, struct rbnode*, int (*)(struct rbnode*, struct rbnode*));
+void            rb_erase(struct rbroot*, struct rbnode*);
+struct rbnode*  rb_next(struct rbnode*);
+
+// sched.c
+void            schedinit(void);
+void            rq_add(struct proc*, int);
+struct proc*    pickproc(struct cpu*);
+void            charge(struct proc*);
+int             schedtick(void);
+void            idle(struct cpu*);
+int             setscheduler(int);
+int             setdeadline(struct proc*, int, int, int);
+int             setaffinity(struct proc*, uint64);
+uint64          getaffinity(struct proc*);
+void            cpustats(struct cpustat*);
+int             setcpuquota(int, int, int);
+int             setcpugroup(struct proc*, int);
+int             cpugroupover(struct proc*);
+void            cpugrouptick(void);
+int             schedrank(struct proc*);
+void            setinherited(struct proc*, int);
+int             handoff(struct proc*);
+extern int      sched_inherit;
+extern int      mlfq_levels;
+extern int      mlfq_boost;
+extern int      mlfq_slice[];
+extern int      mlfq_agelimit[];
+
+// schedtrace.c
+void            schedtraceinit(void);
+void            schedevent(int, struct proc*, int);
+int             schedtrace(uint64, int);
+extern int      schedtrace_on;
+
+// sysctl.c
+void            sysctlinit(void);
+int             sysctl(int, int*, int*);
+
 // swtch.S
 void            swtch(struct context*, struct context*);
 
@@ -149,6 +203,7 @@ int             fetchaddr(uint64, uint64*);
 void            syscall();
 
 // trap.c
+void            ipi(int);
 extern uint     ticks;
 void            trapinit(void);
 void            trapinithart(void);
@@ -176,6 +231,7 @@ void            uvmfree(pagetable_t, uint64);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
 pte_t *         walk(pagetable_t, uint64, int);
+int             cowfault(pagetable_t, uint64);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
 int             copyin(pagetable_t, char *, uint64, uint64);
@@ -1,12 +1,21 @@
 // Physical memory allocator, for user processes,
 // kernel stacks, page-table pages,
 // and pipe buffers. Allocates whole 4096-byte pages.
+//
+// Every cpu keeps a cache of free pages of its own, under a
+// lock that only it takes unless it has run dry, so kalloc()
+// and kfree() normally don't touch anything another cpu is
+// using. A cpu whose cache is empty refills it from the shared
+// pool a batch at a time, and one whose cache has grown too
+// big drains a batch back. If the pool is empty as well, it
+// takes a batch from another cpu's cache.
 
 #include "types.h"
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "kmemstat.h"
 #include "defs.h"
 
 void freerange(void *pa_start, void *pa_end);
@@ -14,38 +23,62 @@ void freerange(void *pa_start, void *pa_end);
 extern char end[]; // first address after kernel.
                    // defined by kernel.ld.
 
+#define KBATCH 32            // pages moved at a time between a cpu and the pool
+#define KCACHE (2 * KBATCH)  // the most pages a cpu keeps
+
 struct run {
   struct run *next;
 };
 
+// the shared pool.
 struct {
   struct spinlock lock;
   struct run *freelist;
+  int npages;       // pages on freelist
+  uint64 nrefill;   // batches handed to cpus
+  uint64 ndrain;    // batches given back by cpus
 } kmem;
 
-// should be in vm.c but I need to lock kmem to mess with mem
-
+// a cpu's own free pages.
+struct kcache {
+  struct spinlock lock;
+  struct run *freelist;
+  int npages;       // pages on freelist
+  uint64 nalloc;    // pages kalloc() has handed out here
+  uint64 nfreed;    // pages kfree() has freed here
+  uint64 nsteal;    // batches taken from other cpus
+} kcache[NCPU];
 
+// should be in vm.c but I need to lock kmem to mess with mem
 
+// reference counts, for copy-on-write fork. they are changed
+// by incRef() and kfree() on any cpu, with atomic adds (amoadd.w
+// on RISC-V) rather than under a lock, so forking a big process
+// doesn't take a lock per page.
 int refs[PHYSTOP / PGSIZE];
 void incRef(uint64 pa)
 {
-  acquire(&kmem.lock);
-
   int toInc = pa / PGSIZE;
   if(toInc < 0 || toInc >= PHYSTOP / PGSIZE)
   {
     panic("incRef: invalid pa");
   }
-  refs[toInc]++;
+  __sync_fetch_and_add(&refs[toInc], 1);
+}
 
-  release(&kmem.lock);
+// How many page tables map the page at pa or, for a leaf
+// page-table page, point at it.
+int getRef(uint64 pa)
+{
+  return *(volatile int*)&refs[pa / PGSIZE];
 }
 
 void
 kinit()
 {
   initlock(&kmem.lock, "kmem");
+  for(int i = 0; i < NCPU; i++)
+    initlock(&kcache[i].lock, "kcache");
   freerange(end, (void*)PHYSTOP);
 }
 
@@ -61,39 +94,139 @@ freerange(void *pa_start, void *pa_end)
   }
 }
 
-// Free the page of physical memory pointed at by pa,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
-void
-kfree(void *pa)
+// Take up to n pages off the list *head, which holds *count
+// of them, and return them as a list of their own.
+static struct run*
+takebatch(struct run **head, int *count, int n, int *taken)
 {
-  struct run *r;
+  struct run *first = *head, *r = *head;
+  int i;
 
-  if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
-    panic("kfree");
+  if(first == 0){
+    *taken = 0;
+    return 0;
+  }
+  for(i = 1; i < n && r->next; i++)
+    r = r->next;
+  *head = r->next;
+  r->next = 0;
+  *count -= i;
+  *taken = i;
+  return first;
+}
+
+// Fill kc, which is empty, with a batch of pages from the
+// pool or, failing that, from another cpu's cache.
+// Caller must hold kc->lock; it is dropped while another
+// cpu's cache is locked, since two cpus could be doing this
+// to each other.
+static void
+refill(struct kcache *kc)
+{
+  struct run *batch;
+  int n;
 
-  int idx = (uint64)pa / PGSIZE;
   acquire(&kmem.lock);
+  batch = takebatch(&kmem.freelist, &kmem.npages, KBATCH, &n);
+  if(batch)
+    kmem.nrefill++;
+  release(&kmem.lock);
+
+  if(batch == 0){
+    release(&kc->lock);
+    for(struct kcache *o = kcache; o < &kcache[NCPU] && batch == 0; o++){
+      if(o == kc || o->npages == 0)
+        continue;
+      acquire(&o->lock);
+      // take half, so the two don't just trade the same pages.
+      batch = takebatch(&o->freelist, &o->npages, (o->npages + 1) / 2, &n);
+      release(&o->lock);
+    }
+    acquire(&kc->lock);
+    if(batch)
+      kc->nsteal++;
+  }
+
+  if(batch){
+    struct run *last = batch;
+    while(last->next)
+      last = last->next;
+    last->next = kc->freelist;
+    kc->freelist = batch;
+    kc->npages += n;
+  }
+}
+
+// Drop a reference to the page at pa, and return how
+// many are left. Whoever takes the count to 0 must give
+// the page back with kfreepage().
+int
+decRef(uint64 pa)
+{
+  int n;
 
-  if(refs[idx] <= 0)
+  if((pa % PGSIZE) != 0 || (char*)pa < end || pa >= PHYSTOP)
+    panic("kfree");
+
+  n = __sync_sub_and_fetch(&refs[pa / PGSIZE], 1);
+  if(n < 0)
   {
     panic("kfree: ref count is 0");
   }
+  return n;
+}
+
+// Free the page of physical memory pointed at by pa,
+// which normally should have been returned by a
+// call to kalloc().  (The exception is when
+// initializing the allocator; see kinit above.)
+void
+kfree(void *pa)
+{
+  // whoever dropped the last reference frees the page.
+  if(decRef((uint64)pa) == 0)
+    kfreepage(pa);
+}
 
-  refs[idx]--;
+// Put the page at pa, whose last reference has been
+// dropped with decRef(), back on a free list.
+void
+kfreepage(void *pa)
+{
+  struct run *r, *batch;
+  struct kcache *kc;
+  int n;
 
-  if(refs[idx] == 0)
-  {
-    // Fill with junk to catch dangling refs.
-    memset(pa, 1, PGSIZE);
+  // Fill with junk to catch dangling refs.
+  memset(pa, 1, PGSIZE);
 
-    r = (struct run*)pa;
-    r->next = kmem.freelist;
-    kmem.freelist = r;
-  }
+  r = (struct run*)pa;
+  push_off();
+  kc = &kcache[cpuid()];
+  acquire(&kc->lock);
+  batch = 0;
+  if(kc->npages >= KCACHE)
+    batch = takebatch(&kc->freelist, &kc->npages, KBATCH, &n);
+  // pa was in use a moment ago; keep it here, where it may
+  // still be cached, and give the pool others.
+  r->next = kc->freelist;
+  kc->freelist = r;
+  kc->npages++;
+  kc->nfreed++;
+  release(&kc->lock);
+  pop_off();
 
-  release(&kmem.lock);
+  if(batch){
+    struct run *last = batch;
+    while(last->next)
+      last = last->next;
+    acquire(&kmem.lock);
+    last->next = kmem.freelist;
+    kmem.freelist = batch;
+    kmem.npages += n;
+    kmem.ndrain++;
+    release(&kmem.lock);
+  }
 }
 
 // Allocate one 4096-byte page of physical memory.
@@ -103,12 +236,27 @@ void *
 kalloc(void)
 {
   struct run *r;
+  struct kcache *kc;
+
+  push_off();
+  kc = &kcache[cpuid()];
+  acquire(&kc->lock);
+  if(kc->freelist == 0)
+    refill(kc);
+  r = kc->freelist;
+  if(r)
+  {
+    kc->freelist = r->next;
+    kc->npages--;
+    kc->nalloc++;
+  }
+  release(&kc->lock);
+  pop_off();
 
-  acquire(&kmem.lock);
-  r = kmem.freelist;
   if(r)
   {
-    kmem.freelist = r->next;
+    // no one else can see the page yet, so its count
+    // can be set with a plain store.
     int idx = (uint64)r / PGSIZE;
 
     if(refs[idx] != 0)
@@ -117,10 +265,26 @@ kalloc(void)
     }
 
     refs[idx] = 1;
-  }
-  release(&kmem.lock);
-
-  if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
+  }
   return (void*)r;
 }
+
+// Copy the allocator's counters into *st. They are read
+// without locks, so they may be a little out of step.
+void
+kmemstats(struct kmemstat *st)
+{
+  memset(st, 0, sizeof(*st));
+  st->nfreepages = kmem.npages;
+  st->nrefill = kmem.nrefill;
+  st->ndrain = kmem.ndrain;
+  st->poolspin = kmem.lock.nspin;
+  for(struct kcache *kc = kcache; kc < &kcache[NCPU]; kc++){
+    st->nfreepages += kc->npages;
+    st->nalloc += kc->nalloc;
+    st->nfree += kc->nfreed;
+    st->nsteal += kc->nsteal;
+    st->cachespin += kc->lock.nspin;
+  }
+}
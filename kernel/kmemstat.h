@@ -0,0 +1,12 @@
+// Physical page allocator statistics, from kmemstats().
+// Spins count the turns acquire() took waiting for a lock.
+struct kmemstat {
+  int nfreepages;     // Free pages, in the shared pool and the cpus' caches
+  uint64 nalloc;      // Pages handed out by kalloc()
+  uint64 nfree;       // Pages given back by kfree()
+  uint64 nrefill;     // Batches a cpu took from the shared pool
+  uint64 ndrain;      // Batches a cpu gave back to the shared pool
+  uint64 nsteal;      // Batches a cpu took from another cpu's cache
+  uint64 poolspin;    // Spins on the shared pool's lock
+  uint64 cachespin;   // Spins on the cpus' cache locks
+};
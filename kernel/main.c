@@ -20,6 +20,9 @@ main()
     kvminit();       // create kernel page table
     kvminithart();   // turn on paging
     procinit();      // process table
+    schedinit();     // run queues
+    sysctlinit();    // kernel parameters
+    schedtraceinit(); // scheduler event rings
     trapinit();      // trap vectors
     trapinithart();  // install kernel trap vector
     plicinit();      // set up interrupt controller
@@ -1,5 +1,9 @@
+#ifndef NPROC
 #define NPROC        64  // maximum number of processes
+#endif
 #define NCPU          8  // maximum number of CPUs
+#define MAXPID    32768  // pids wrap around after this
+#define NCPUGROUP    16  // cpu bandwidth groups, see setcpuquota()
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
@@ -11,3 +15,4 @@
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       2000  // size of file system in blocks
 #define MAXPATH      128   // maximum file path name
+#define TIMERINTERVAL 1000000 // cycles between timer interrupts; about 1/10th second in qemu
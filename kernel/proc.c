@@ -3,7 +3,11 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
+#include "sched.h"
+#include "rusage.h"
+#include "schedtrace.h"
 #include "defs.h"
 
 struct cpu cpus[NCPU];
@@ -15,8 +19,14 @@ struct proc *initproc;
 int nextpid = 1;
 struct spinlock pid_lock;
 
+// Live processes by pid, chained through p->pidnext.
+// Protected by pid_lock, which is taken after p->lock.
+static struct proc *pidhash[NPROC];
+#define PIDHASH(pid) ((pid) % NPROC)
+
 extern void forkret(void);
 static void freeproc(struct proc *p);
+static int startchild(struct proc *np);
 
 extern char trampoline[]; // trampoline.S
 
@@ -27,6 +37,54 @@ extern char trampoline[]; // trampoline.S
 struct spinlock wait_lock;
 
 static unsigned long int next = 1;
+
+// Sleeping processes, hashed by channel, so that wakeup() only
+// looks at the processes sleeping on channels in one bucket.
+// A wait queue's lock is taken before any p->lock.
+#define NWAITQ 64
+
+struct waitq {
+  struct spinlock lock;
+  struct proc *head;
+} waitq[NWAITQ];
+
+static struct waitq *
+waitqof(void *chan)
+{
+  // Fibonacci hashing; the top bits are the best mixed.
+  return &waitq[((uint64)chan * 0x9E3779B97F4A7C15UL) >> 58];
+}
+
+static void
+wq_unlink(struct proc *p)
+{
+  struct waitq *wq = p->wq;
+
+  if(p->wprev)
+    p->wprev->wnext = p->wnext;
+  else
+    wq->head = p->wnext;
+  if(p->wnext)
+    p->wnext->wprev = p->wprev;
+  p->wnext = p->wprev = 0;
+  p->wq = 0;
+}
+
+// Mark p RUNNABLE and hand it to the scheduler.
+// Caller must hold p->lock.
+static void
+setrunnable(struct proc *p)
+{
+  uint64 now = r_time();
+
+  if(p->state == SLEEPING)
+    p->cyc_sleep += now - p->cyc_switch;
+  p->cyc_switch = now;
+  p->state = RUNNABLE;
+  rq_add(p, 0);
+  schedevent(EV_WAKEUP, p, p->cpu);
+}
+
 // Allocate a page for each process's kernel stack.
 // Map it high in memory, followed by an invalid
 // guard page.
@@ -52,6 +110,8 @@ procinit(void)
   
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
+  for(int i = 0; i < NWAITQ; i++)
+    initlock(&waitq[i].lock, "waitq");
   for(p = proc; p < &proc[NPROC]; p++) {
       initlock(&p->lock, "proc");
       p->state = UNUSED;
@@ -90,19 +150,56 @@ myproc(void)
   return p;
 }
 
-int
-allocpid()
+static struct proc*
+pidlookup(int pid)
+{
+  struct proc *p;
+
+  for(p = pidhash[PIDHASH(pid)]; p; p = p->pidnext)
+    if(p->pid == pid)
+      return p;
+  return 0;
+}
+
+// Give p the next pid and add it to the pid hash.
+// pids are handed out in order, so one is not used again
+// until MAXPID more processes have been created; after the
+// wrap-around, pids still in use are skipped.
+static int
+allocpid(struct proc *p)
 {
   int pid;
   
   acquire(&pid_lock);
-  pid = nextpid;
-  nextpid = nextpid + 1;
+  do {
+    pid = nextpid;
+    nextpid = nextpid == MAXPID ? 1 : nextpid + 1;
+  } while(pidlookup(pid));
+  p->pid = pid;
+  p->pidnext = pidhash[PIDHASH(pid)];
+  pidhash[PIDHASH(pid)] = p;
   release(&pid_lock);
 
   return pid;
 }
 
+static void
+freepid(struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&pid_lock);
+  for(pp = &pidhash[PIDHASH(p->pid)]; *pp; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  }
+  release(&pid_lock);
+  p->pidnext = 0;
+  p->pid = 0;
+}
+
 // Look in the process table for an UNUSED proc.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
@@ -123,8 +220,11 @@ allocproc(void)
   return 0;
 
 found:
-  p->pid = allocpid();
+  allocpid(p);
   p->state = USED;
+  p->cpu = cpuid();
+  p->affinity = (1L << NCPU) - 1;
+  p->group = 0;
   p->createTime = ticks;
   p->priority = 60;
   p->timesScheduled = 0;
@@ -136,6 +236,11 @@ found:
   p->timeRun = 0;
   p->timeRanInQueue = 0;
   p->timeSlept = 0;
+  p->pass = 0;
+  p->vruntime = 0;
+  p->weight = 1024;
+  p->dl_runtime = 0;
+  p->dl_bw = 0;
   p->alarmFreq = 0;
   p->lastAlarm = 0;
   p->alarmRunning = 0;
@@ -163,24 +268,40 @@ found:
   p->rtime = 0;
   p->etime = 0;
   p->ctime = ticks;
+  p->cyc_run = p->cyc_wait = p->cyc_sleep = 0;
+  p->cyc_start = p->cyc_switch = r_time();
 
   p->entryTime = ticks;
   p->queue = 0;
   p->timeRanInQueue = 0;
+  p->inherited = NOINHERIT;
+  p->held = 0;
+  p->cowcopied = 0;
+  p->cowreused = 0;
 
   return p;
 }
 
+// Find the process with the given pid in the pid hash
+// and return it with p->lock held, or 0 if there is none.
 struct proc* getProc(int pid){
   struct proc *p;
-  for(p = proc; p < &proc[NPROC]; p++) {
-    acquire(&p->lock);
-    if(p->pid == pid) {
-      return p;
-    }
+
+  if(pid <= 0)
+    return 0;
+  acquire(&pid_lock);
+  p = pidlookup(pid);
+  release(&pid_lock);
+  if(p == 0)
+    return 0;
+  // p->lock comes before pid_lock, so p may have exited
+  // in between; its slot is still a struct proc.
+  acquire(&p->lock);
+  if(p->pid != pid){
     release(&p->lock);
+    return 0;
   }
-  return 0;
+  return p;
 }
 
 // free a proc structure and the data hanging from it,
@@ -196,7 +317,8 @@ freeproc(struct proc *p)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
   p->sz = 0;
-  p->pid = 0;
+  if(p->pid)
+    freepid(p);
   p->parent = 0;
   p->name[0] = 0;
   p->chan = 0;
@@ -283,7 +405,7 @@ userinit(void)
   safestrcpy(p->name, "initcode", sizeof(p->name));
   p->cwd = namei("/");
 
-  p->state = RUNNABLE;
+  setrunnable(p);
 
   release(&p->lock);
 }
@@ -302,16 +424,59 @@ growproc(int n)
       return -1;
     }
   } else if(n < 0){
-    sz = uvmdealloc(p->pagetable, sz, sz + n);
+    if((sz = uvmdealloc(p->pagetable, sz, sz + n)) == p->sz)
+      return -1;
   }
   p->sz = sz;
   return 0;
 }
 
+// Fill in ru with p's cpu accounting so far.
+// Caller must hold p->lock.
+static void
+fillrusage(struct proc *p, struct rusage *ru)
+{
+  uint64 now = p->state == ZOMBIE ? p->cyc_switch : r_time();
+
+  ru->ru_run = p->cyc_run;
+  ru->ru_wait = p->cyc_wait;
+  ru->ru_sleep = p->cyc_sleep;
+  // the time since its last change of state is not charged yet.
+  if(p->state == RUNNING)
+    ru->ru_run += now - p->cyc_switch;
+  else if(p->state == RUNNABLE)
+    ru->ru_wait += now - p->cyc_switch;
+  else if(p->state == SLEEPING)
+    ru->ru_sleep += now - p->cyc_switch;
+  ru->ru_elapsed = now - p->cyc_start;
+  ru->ru_nswitch = p->timesScheduled;
+  ru->ru_cowcopied = p->cowcopied;
+  ru->ru_cowreused = p->cowreused;
+}
+
+// Copy the cpu accounting of the process with the given
+// pid, or of the caller if pid is 0, into ru.
+// Returns -1 if there is no such process.
+int
+getrusage(int pid, struct rusage *ru)
+{
+  struct proc *p;
+
+  if(pid == 0){
+    p = myproc();
+    acquire(&p->lock);
+  } else if((p = getProc(pid)) == 0){
+    return -1;
+  }
+  fillrusage(p, ru);
+  release(&p->lock);
+  return 0;
+}
+
 // Wait for a child process to exit and return its pid.
 // Return -1 if this process has no children.
 int
-waitx(uint64 addr, uint* wtime, uint* rtime)
+waitx(uint64 addr, uint* wtime, uint* rtime, struct rusage *ru)
 {
   struct proc *np;
   int havekids, pid;
@@ -333,6 +498,7 @@ waitx(uint64 addr, uint* wtime, uint* rtime)
           pid = np->pid;
           *rtime = np->rtime;
           *wtime = np->etime - np->ctime - np->rtime;
+          fillrusage(np, ru);
           if(addr != 0 && copyout(p->pagetable, addr, (char *)&np->xstate,
                                   sizeof(np->xstate)) < 0) {
             release(&np->lock);
@@ -359,25 +525,12 @@ waitx(uint64 addr, uint* wtime, uint* rtime)
   }
 }
 
-void
-update_time()
-{
-  struct proc* p;
-  for (p = proc; p < &proc[NPROC]; p++) {
-    acquire(&p->lock);
-    if (p->state == RUNNING) {
-      p->rtime++;
-    }
-    release(&p->lock); 
-  }
-}
-
 // Create a new process, copying the parent.
 // Sets up child kernel stack to return as if from fork() system call.
 int
 fork(void)
 {
-  int i, pid;
+  int i;
   struct proc *np;
   struct proc *p = myproc();
 
@@ -408,26 +561,72 @@ fork(void)
 
   safestrcpy(np->name, p->name, sizeof(p->name));
 
-  pid = np->pid;
-
   release(&np->lock);
 
+  return startchild(np);
+}
+
+// Make np, which is set up but has never run, a child of
+// the caller, and let it run. Returns its pid.
+static int
+startchild(struct proc *np)
+{
+  struct proc *p = myproc();
+  int pid = np->pid;
+
   acquire(&wait_lock);
   np->parent = p;
   if(np->parent)
   {
     np->trace = np->parent->trace;
     np->tickets = np->parent->tickets;
+    np->affinity = np->parent->affinity;
+    np->group = np->parent->group;
+    np->vruntime = np->parent->vruntime;
   }
   release(&wait_lock);
 
   acquire(&np->lock);
-  np->state = RUNNABLE;
+  setrunnable(np);
   release(&np->lock);
 
   return pid;
 }
 
+// Create a child process running the program at path, as
+// fork() followed by exec() in the child would, but without
+// copying the caller's memory only to throw it away. ofile
+// is the child's table of open files, which it takes over
+// if the exec succeeds.
+// Returns the child's pid, or -1 on error.
+int
+spawn(char *path, char **argv, struct file **ofile)
+{
+  int i, argc;
+  struct proc *np;
+
+  if((np = allocproc()) == 0){
+    return -1;
+  }
+  // np can't run until startchild(), and exec may sleep.
+  release(&np->lock);
+
+  memset(np->trapframe, 0, sizeof(*np->trapframe));
+  if((argc = execproc(np, path, argv)) < 0){
+    acquire(&np->lock);
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
+  np->trapframe->a0 = argc;
+
+  for(i = 0; i < NOFILE; i++)
+    np->ofile[i] = ofile[i];
+  np->cwd = idup(myproc()->cwd);
+
+  return startchild(np);
+}
+
 // Pass p's abandoned children to init.
 // Caller must hold wait_lock.
 void
@@ -468,6 +667,10 @@ exit(int status)
   end_op();
   p->cwd = 0;
 
+  // Give back its cpu reservation, if any.
+  if(p->dl_runtime)
+    setdeadline(p, 0, 0, 0);
+
   acquire(&wait_lock);
 
   // Give any children to init.
@@ -557,43 +760,6 @@ wait(uint64 addr)
   }
 }
 
-// age all the processes if MLFQ is enabled
-# ifdef MLFQ
-void
-age(void)
-{
-  struct proc *p;
-  for(p = proc; p < &proc[NPROC]; p++)
-  {
-    acquire(&p->lock);
-    if (p->state == RUNNABLE || p->state == SLEEPING)
-    {
-      if (p->queue){
-        int limit;
-        if (p->queue == 1)
-          limit = 40;
-        else if (p->queue == 2)
-          limit = 30;
-        else if (p->queue == 3)
-          limit = 25;
-        else
-          limit = 20;
-        // p->timeInQueue = ticks - p->entryTime
-        int waitTime = (int)(ticks - p->entryTime - p->timeRanInQueue);
-
-        if (waitTime >= limit)
-        {
-          p->queue--; 
-          p->timeRanInQueue = 0;
-          p->entryTime = ticks;
-        }
-      }
-    }
-    release(&p->lock);
-  }
-}
-# endif
-
 // Per-CPU process scheduler.
 // Each CPU calls scheduler() after setting itself up.
 // Scheduler never returns.  It loops, doing:
@@ -605,356 +771,57 @@ void
 scheduler(void)
 {
   struct proc *p;
+  uint64 start;
   struct cpu *c = mycpu();
   
   c->proc = 0;
+  c->start = r_time();
+  c->online = 1;
   for(;;){
     srand(ticks);
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
-    #ifdef RR
-    // printf("RR\n");
-    for(p = proc; p < &proc[NPROC]; p++) {
-      acquire(&p->lock);
-      if(p->state == RUNNABLE) {
-        // Switch to chosen process.  It is the process's job
-        // to release its lock and then reacquire it
-        // before jumping back to us.
-        p->state = RUNNING;
-        c->proc = p;
-        p->lastScheduled = ticks; 
-        swtch(&c->context, &p->context);
-      
-        // Process is done running for now.
-        // It should have changed its p->state before coming back.
-        c->proc = 0;
-      }
-
-      release(&p->lock);
-    }
-    #endif
-
-    #ifdef FCFS
-    struct proc *min = 0;
-    for (p = proc; p < &proc[NPROC]; p++)
-    {
-      acquire(&p->lock);
-      if (p->state == RUNNABLE && (min == 0 || p->createTime < min->createTime))
-      {
-        min = p;
-      }
-      release(&p->lock);
-    }
-
-    if (min)
-    {
-      acquire(&min->lock);
-      if (min->state == RUNNABLE)
-      {
-        min->state = RUNNING;
-        c->proc = min;
-        min->lastScheduled = ticks; 
-        swtch(&c->context, &min->context);
-        c->proc = 0;
-      }
-      release(&min->lock);
-    }
-    #endif
-
-    #ifdef LBS
-    // get total tickets
-    int totalTickets = 0;
-    for (p = proc; p < &proc[NPROC]; p++)
-    {
-      acquire(&p->lock);
-      if (p->state == RUNNABLE)
-      {
-        totalTickets += p->tickets;
-      }
-      // release(&p->lock);
-    }
-
-    int random = rand() % totalTickets;
-
-    struct proc *winner = 0;
-    for (p = proc; p < &proc[NPROC]; p++)
-    {
-      // acquire(&p->lock);
-      if (p->state == RUNNABLE && !winner)
-      {
-        random -= p->tickets;
-        if (random < 0)
-        {
-          winner = p;
-        }
-      }
-
-      if(p != winner)
-        release(&p->lock);
-    }
-
-    if (winner)
-    {
-      if (winner->state == RUNNABLE)
-      {
-        winner->state = RUNNING;
-        c->proc = winner;
-        winner->lastScheduled = ticks; 
-        swtch(&c->context, &winner->context);
-        c->proc = 0;
-      }
-      release(&winner->lock);
-    }
-
-    #endif
-
-
-    #ifdef PBS
-    // printf("PBS\n");
-    struct proc *max = 0;
-    for (p = proc; p < &proc[NPROC]; p++)
-    {
-      acquire(&p->lock);
-      if (p->state == RUNNABLE)
-      {
-        if(!max)
-        {
-          max = p;
-        }
-        else
-        {
-          int newDp = getDP(p);
-          int maxDp = getDP(max);
-
-          if(newDp < maxDp)
-          {
-            max = p;
-          }
-          else if(newDp == maxDp)
-          {
-            if(p->timesScheduled < max->timesScheduled)
-            {
-              max = p;
-            }
-            else if (p->timesScheduled == max->timesScheduled)
-            {
-              if(p->createTime < max->createTime)
-              {
-                max = p;
-              }
-            }
-          }
-        }
-      }
-      release(&p->lock);
-    }
-
-    if (max)
-    {
-      acquire(&max->lock);
-      if (max->state == RUNNABLE)
-      {
-        max->state = RUNNING;
-        c->proc = max;
-        max->timesScheduled++;
-        max->lastScheduled = ticks;
-        swtch(&c->context, &max->context);
-        c->proc = 0;
-      }
-      release(&max->lock);
+    p = pickproc(c);
+    if(p == 0){
+      idle(c);
+      continue;
     }
 
-    #endif
-
-    # ifdef MLFQ
-
-    // aging for processes
-    // age();
-    int limit;
-
-    // if the process has been in the queue for long enough, demote it
-    for (p = proc; p < &proc[NPROC]; p++){
-      acquire(&p->lock);
-      if (p->state == RUNNING || p->state == RUNNABLE){
-        if (p->queue == 0)
-          limit = 1;
-        else if (p->queue == 1)
-          limit = 2;
-        else if (p->queue == 2)
-          limit = 4;
-        else if (p->queue == 3)
-          limit = 8;
-        else
-          limit = 16;
-        if (p->timeRanInQueue >= limit && p->queue < 4)
-        {
-          p->queue++;
-          p->entryTime = ticks;
-          p->timeRanInQueue = 0;          
-        }
-      }
-      release(&p->lock);
-    }
-    age();
-    
-    // select the process to run
-    struct proc *procToRun = 0;
-    for (p = proc; p < &proc[NPROC]; p++)
-    {
-      acquire(&p->lock);
-      if (p->state == RUNNABLE && p->queue == 0)
-      {
-        if (!procToRun)
-        {
-          procToRun = p;
-        }
-        else
-        {
-          if (p->queue < procToRun->queue)
-          {
-            procToRun = p;
-          }
-          else if (p->queue == procToRun->queue)
-          {
-            if (p->entryTime < procToRun->entryTime)
-            {
-              procToRun = p;
-            }
-          }
-        }
-      }
+    acquire(&p->lock);
+    if(p->state != RUNNABLE)
+      panic("scheduler: queued proc not runnable");
+    if(cpugroupover(p)){
+      // its cpu group ran out while it was queued;
+      // rq_add() parks it until the next period.
+      rq_add(p, 0);
       release(&p->lock);
+      continue;
     }
 
-    // loop over queue = 1 now
-    if (!procToRun){
-      for (p = proc; p < &proc[NPROC]; p++)
-      {
-        acquire(&p->lock);
-        if (p->state == RUNNABLE && p->queue == 1)
-        {
-          if (!procToRun)
-          {
-            procToRun = p;
-          }
-          else
-          {
-            if (p->queue < procToRun->queue)
-            {
-              procToRun = p;
-            }
-            else if (p->queue == procToRun->queue)
-            {
-              if (p->entryTime < procToRun->entryTime)
-              {
-                procToRun = p;
-              }
-            }
-          }
-        }
-        release(&p->lock);
-      }
-    }
-
-    // loop over queue = 2 now
-    if (!procToRun){
-      for (p = proc; p < &proc[NPROC]; p++)
-      {
-        acquire(&p->lock);
-        if (p->state == RUNNABLE && p->queue == 2)
-        {
-          if (!procToRun)
-          {
-            procToRun = p;
-          }
-          else
-          {
-            if (p->queue < procToRun->queue)
-            {
-              procToRun = p;
-            }
-            else if (p->queue == procToRun->queue)
-            {
-              if (p->entryTime < procToRun->entryTime)
-              {
-                procToRun = p;
-              }
-            }
-          }
-        }
-        release(&p->lock);
-      }
-    }
-
-    // loop over queue = 3 now
-    if (!procToRun){
-      for (p = proc; p < &proc[NPROC]; p++)
-      {
-        acquire(&p->lock);
-        if (p->state == RUNNABLE && p->queue == 3)
-        {
-          if (!procToRun)
-          {
-            procToRun = p;
-          }
-          else
-          {
-            if (p->queue < procToRun->queue)
-            {
-              procToRun = p;
-            }
-            else if (p->queue == procToRun->queue)
-            {
-              if (p->entryTime < procToRun->entryTime)
-              {
-                procToRun = p;
-              }
-            }
-          }
-        }
-        release(&p->lock);
-      }
-    }
-
-    // if process found yet, run it
-    if (procToRun)
-    {
-      acquire(&procToRun->lock);
-      if (procToRun->state == RUNNABLE)
-      {
-        procToRun->state = RUNNING;
-        c->proc = procToRun;
-        // procToRun->entryTime = ticks;
-        procToRun->lastScheduled = ticks; 
-        swtch(&c->context, &procToRun->context);
-        c->proc = 0;
-      }
-      release(&procToRun->lock);
-    }
-
-    // process not found in queues 0,1,2,3; now run round robin (rr) over queue 4
-    else {
-      for(p = proc; p < &proc[NPROC]; p++) {
-        acquire(&p->lock);
-        if(p->state == RUNNABLE && p->queue == 4) {
-          // Switch to chosen process.  It is the process's job
-          // to release its lock and then reacquire it
-          // before jumping back to us.
-          p->state = RUNNING;
-          c->proc = p;
-          swtch(&c->context, &p->context);
-        
-          // Process is done running for now.
-          // It should have changed its p->state before coming back.
-          c->proc = 0;
-        }
-
-        release(&p->lock);
-      }
-    }
-
-    # endif
+    // Switch to chosen process.  It is the process's job
+    // to release its lock and then reacquire it
+    // before jumping back to us.
+    p->state = RUNNING;
+    p->cpu = c - cpus;
+    c->proc = p;
+    p->timesScheduled++;
+    p->lastScheduled = ticks;
+    p->runstart = r_time();
+    p->charged = p->runstart;
+    p->cyc_wait += p->runstart - p->cyc_switch;
+    p->cyc_switch = p->runstart;
+    c->nswitch++;
+    start = p->runstart;
+    schedevent(EV_SWITCHIN, p, p->queue);
+    swtch(&c->context, &p->context);
+
+    // Process is done running for now.
+    // It should have changed its p->state before coming back.
+    c->busy += r_time() - start;
+    schedevent(EV_SWITCHOUT, p, p->state);
+    c->proc = 0;
+    release(&p->lock);
   }
 }
 
@@ -969,6 +836,7 @@ void
 sched(void)
 {
   int intena;
+  uint64 now;
   struct proc *p = myproc();
 
   if(!holding(&p->lock))
@@ -980,28 +848,75 @@ sched(void)
   if(intr_get())
     panic("sched interruptible");
 
+  // it has been running since it was dispatched.
+  now = r_time();
+  p->cyc_run += now - p->cyc_switch;
+  p->cyc_switch = now;
+  // charge the ticks it ran for here rather than on every
+  // tick; an exiting process stopped the clock at etime.
+  p->rtime += (p->state == ZOMBIE ? p->etime : ticks) - p->lastScheduled;
+
   intena = mycpu()->intena;
   swtch(&p->context, &mycpu()->context);
   mycpu()->intena = intena;
 }
 
-// Give up the CPU for one scheduling round.
-void
-yield(void)
+// Queue the current process again and switch to the
+// scheduler; yielded says why (YIELD_* in proc.h).
+static void
+giveup(int yielded)
 {
   struct proc *p = myproc();
   acquire(&p->lock);
-  p->state = RUNNABLE;
+  charge(p);
   p->timeRun += ticks - p->lastScheduled;
   p->timeRanInQueue += ticks - p->lastScheduled;
 
   if(p->timeSlept + p->timeRun)
     p->niceness = (10 * (p->timeSlept)) / (p->timeSlept + p->timeRun);
 
+  p->state = RUNNABLE;
+  rq_add(p, yielded);
+
   sched();
   release(&p->lock);
 }
 
+// Give up the CPU for one scheduling round.
+void
+yield(void)
+{
+  giveup(YIELD_PREEMPTED);
+}
+
+// Give up the CPU and go behind the processes waiting
+// at the same priority, for sched_yield().
+void
+sched_yield(void)
+{
+  giveup(YIELD_GAVEUP);
+}
+
+// Give up the CPU to process pid, which runs next on this
+// CPU whatever the policy would have picked, for yield_to().
+// Returns -1, without giving up the CPU, if pid is not
+// waiting to run or may not run on this CPU.
+int
+yieldto(int pid)
+{
+  struct proc *t;
+
+  if(pid == myproc()->pid || (t = getProc(pid)) == 0)
+    return -1;
+  if(handoff(t) < 0){
+    release(&t->lock);
+    return -1;
+  }
+  release(&t->lock);
+  giveup(YIELD_GAVEUP);
+  return 0;
+}
+
 // A fork child's very first scheduling by scheduler()
 // will swtch to forkret.
 void
@@ -1029,14 +944,16 @@ void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct waitq *wq = waitqof(chan);
   
   // Must acquire p->lock in order to
   // change p->state and then call sched.
-  // Once we hold p->lock, we can be
+  // Once we hold the wait queue's lock, we can be
   // guaranteed that we won't miss any wakeup
-  // (wakeup locks p->lock),
+  // (wakeup locks it, and then p->lock),
   // so it's okay to release lk.
 
+  acquire(&wq->lock);
   acquire(&p->lock);  //DOC: sleeplock1
   release(lk);
 
@@ -1044,14 +961,28 @@ sleep(void *chan, struct spinlock *lk)
   p->chan = chan;
   p->state = SLEEPING;
   p->lastSlept = ticks;
+  p->wq = wq;
+  p->wprev = 0;
+  p->wnext = wq->head;
+  if(wq->head)
+    wq->head->wprev = p;
+  wq->head = p;
+  release(&wq->lock);
+  charge(p);
 
   sched();
 
   // Tidy up.
   p->chan = 0;
+  release(&p->lock);
+
+  // wakeup() takes us off the wait queue, but kill() does not.
+  acquire(&wq->lock);
+  if(p->wq)
+    wq_unlink(p);
+  release(&wq->lock);
 
   // Reacquire original lock.
-  release(&p->lock);
   acquire(lk);
 }
 
@@ -1060,13 +991,17 @@ sleep(void *chan, struct spinlock *lk)
 void
 wakeup(void *chan)
 {
-  struct proc *p;
+  struct waitq *wq = waitqof(chan);
+  struct proc *p, *next;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
+  acquire(&wq->lock);
+  for(p = wq->head; p; p = next) {
+    next = p->wnext;
     if(p != myproc()){
       acquire(&p->lock);
       if(p->state == SLEEPING && p->chan == chan) {
-        p->state = RUNNABLE;
+        wq_unlink(p);
+        setrunnable(p);
         p->timeSlept += ticks - p->lastSlept;
         if(p->timeSlept + p->timeRun)
           p->niceness = (10 * (p->timeSlept)) / (p->timeSlept + p->timeRun);
@@ -1075,6 +1010,7 @@ wakeup(void *chan)
       release(&p->lock);
     }
   }
+  release(&wq->lock);
 }
 
 // Kill the process with the given pid.
@@ -1085,20 +1021,15 @@ kill(int pid)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++){
-    acquire(&p->lock);
-    if(p->pid == pid){
-      p->killed = 1;
-      if(p->state == SLEEPING){
-        // Wake process from sleep().
-        p->state = RUNNABLE;
-      }
-      release(&p->lock);
-      return 0;
-    }
-    release(&p->lock);
+  if((p = getProc(pid)) == 0)
+    return -1;
+  p->killed = 1;
+  if(p->state == SLEEPING){
+    // Wake process from sleep().
+    setrunnable(p);
   }
-  return -1;
+  release(&p->lock);
+  return 0;
 }
 
 void
@@ -1169,32 +1100,16 @@ procdump(void)
 
   printf("\n");
 
-  #ifdef RR
-  printf("Procdump: Round Robin Scheduler\n\n");
-  #endif
-
-  #ifdef FCFS
-  printf("Procdump: First Come First Serve Scheduler\n\n");
-  #endif
-
-  #ifdef PBS
-  printf("Procdump: Priority Based Scheduler\n\n");
-  #endif
-
-  #ifdef LBS
-  printf("Procdump: Lottery Based Scheduler\n\n");
-  #endif
-  
-  #ifndef MLFQ
-  printf("PID        State          Time Run       Time Slept      Name       \n");
-  #endif
+  // MLFQ prints bare comma-separated lines for makegraph.py.
+  if(schedpolicy->id != SCHED_MLFQ){
+    printf("Procdump: %s\n\n", schedpolicy->name);
+    printf("PID        State          Time Run       Time Slept      Name       \n");
+  }
 
-  #ifdef MLFQ
   // printf("Procdump: Multi Level Feedback Queue Scheduler %d\n\n", ticks);
   // printf("PID        State          Queue      Time Run      Time Wait      Lastsched     Name       \n");
-  #endif
 
-  #ifndef MLFQ
+  if(schedpolicy->id != SCHED_MLFQ){
   for(p = proc; p < &proc[NPROC]; p++){
     if(p->state == UNUSED)
       continue;
@@ -1219,9 +1134,7 @@ procdump(void)
     printf("%s\n", p->name);    
   }
   printf("\n");
-  #endif
-
-  #ifdef MLFQ
+  } else {
     for(p = proc; p < &proc[NPROC]; p++){
       if(p->state == UNUSED)
         continue;
@@ -1261,7 +1174,7 @@ procdump(void)
         printf("%d,%d,%d,%s\n", p->pid, p->queue, ticks, state);    
     }
     printf("\n");
-  #endif
+  }
 }
 
 int rand(void) 
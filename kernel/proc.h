@@ -18,15 +18,100 @@ struct context {
   uint64 s11;
 };
 
+#define NQUEUE 5               // number of MLFQ levels
+#define MLFQ_WHEEL 64          // ticks covered by one turn of the MLFQ aging wheel
+#define NOINHERIT 1000         // p->inherited when no sleeplock waiter lends p its priority
+
+struct proc;
+struct runq;
+
+// Why a running process is being queued again: the yielded
+// argument of rq_add() and of a policy's enqueue.
+#define YIELD_PREEMPTED 1     // the scheduler took the cpu away
+#define YIELD_GAVEUP    2     // it gave the cpu up itself, with sched_yield() or yield_to()
+
+// A scheduling policy (see sched.c). All of them are built
+// into the kernel; each run queue is organized by one of them.
+// enqueue, dequeue, pick and dispatch are called with the
+// run queue locked.
+struct policy {
+  int id;                     // SCHED_* in sched.h
+  char *name;
+  // put p on rq. yielded is YIELD_* if p was running until
+  // now, and 0 if it is new or has just woken up.
+  void (*enqueue)(struct runq *rq, struct proc *p, int yielded);
+  void (*dequeue)(struct runq *rq, struct proc *p);
+  // the queued process that should run next, left on the queue.
+  // it may not be allowed on this cpu, so pick changes nothing.
+  struct proc *(*pick)(struct runq *rq);
+  // p, just dequeued from rq, is about to run: charge it for that.
+  void (*dispatch)(struct runq *rq, struct proc *p);
+  // called without the lock on a timer interrupt: should p,
+  // running on the cpu that owns rq, give the cpu up?
+  int (*timeslice_over)(struct runq *rq, struct proc *p);
+};
+
+// Per-CPU run queue of RUNNABLE processes, linked through
+// p->qnext and p->qprev. MLFQ keeps a FIFO per level; the
+// other policies only use level 0, plus whatever structure
+// of their own they keep alongside.
+// acquire p->lock before rq.lock, and hold at most one rq.lock.
+struct runq {
+  struct spinlock lock;
+  struct policy *policy;      // How this queue is organized right now
+  struct proc *head[NQUEUE];
+  struct proc *tail[NQUEUE];
+  int nrunnable;              // Processes on this queue (read without lock by thieves)
+  int nallowed[NCPU];         // How many of them may run on each cpu (likewise)
+
+  // MLFQ
+  struct proc *wheel[MLFQ_WHEEL]; // Aging wheel: processes by tick of their next promotion
+  int naging;                 // Processes on the wheel
+  uint wheeltick;             // Last tick the wheel was turned to
+  uint boosttick;             // Tick of the last boost applied here
+
+  // LBS
+  int tickets;                // Total tickets held by processes on this queue
+  int fenwick[NPROC+1];       // Fenwick tree of tickets, indexed by proc slot + 1
+
+  // STRIDE
+  struct proc *heap[NPROC];   // Min-heap of queued processes, keyed by pass
+  int nheap;                  // Processes in heap
+  uint64 pass;                // Pass of the last process picked from this queue
+
+  // CFS
+  struct rbroot cfs;          // Queued processes, ordered by vruntime
+  uint64 min_vruntime;        // Never decreases; where newcomers are placed
+  uint64 load;                // Sum of the weights of queued processes
+
+  // EDF reservations, which run ahead of whatever policy is active
+  struct rbroot dl;           // Processes with budget left, ordered by deadline
+  struct proc *dlthrottled;   // Processes out of budget until their next period, linked by qnext
+  uint64 dl_bw;               // Bandwidth reserved on this cpu; dl_lock protects it
+};
+
 // Per-CPU state.
 struct cpu {
   struct proc *proc;          // The process running on this cpu, or null.
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  struct runq rq;             // Processes waiting to run on this cpu.
+  int online;                 // Has this cpu entered scheduler()?
+  int idle;                   // Waiting in idle() for something to run
+  uint lastbalance;           // Tick of its last balance()
+  struct proc *next;          // Handed this cpu by yield_to(), off every queue; only this cpu uses it
+
+  // statistics, for cpustats()
+  uint64 start;               // time CSR when it came online
+  uint64 busy;                // Cycles spent running processes
+  uint64 idletime;            // Cycles spent in wfi
+  int nswitch;                // Processes it has switched to
+  int nmigrated;              // Processes it has pulled off other cpus' queues
 };
 
 extern struct cpu cpus[NCPU];
+extern struct policy *schedpolicy;
 
 // per-process data for the trap handling code in trampoline.S.
 // sits in a page by itself just under the trampoline page in the
@@ -79,6 +164,9 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+struct waitq;
+struct sleeplock;
+
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -91,6 +179,7 @@ struct proc {
   int killed;                  // If non-zero, have been killed
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
+  struct proc *pidnext;        // Next in the same pid hash chain, under pid_lock
   int createTime;              // Process creation time
   int priority;                // Process priority
   int timesScheduled;          // Number of times the process has been scheduled
@@ -100,8 +189,12 @@ struct proc {
   int lastScheduled;           // Time the process last ran
   int timeSlept;               // Total time the process has slept
   int timeRun;                 // Total time the process has been run
+  int cpu;                     // CPU whose run queue the process goes on
+  uint64 affinity;             // CPUs it may run on, a bit for each
+  int group;                   // CPU bandwidth group
+  int inherited;               // Most urgent rank lent by waiters for its sleeplocks
 
-  int trace;                   // Tracing
+  uint64 trace;                // Mask of system calls to trace
 
   int alarmFreq;               // Alarm frequency
   uint64 alarmHandler;              // Alarm handler
@@ -121,13 +214,60 @@ struct proc {
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+  struct sleeplock *held;      // Sleeplocks it holds, linked by nextheld
+  int cowcopied;               // Copy-on-write faults that copied the page
+  int cowreused;               // Copy-on-write faults that took over a page no one else had
+
 
+  // cpu accounting in cycles of the time CSR, brought up
+  // to date whenever the process changes state:
+  uint64 cyc_run;              // Time spent running
+  uint64 cyc_wait;             // Time spent runnable, waiting for a cpu
+  uint64 cyc_sleep;            // Time spent sleeping
+  uint64 cyc_start;            // time CSR when the process was created
+  uint64 cyc_switch;           // time CSR at its last change of state
 
-  uint rtime;                   // How long the process ran for
+  uint rtime;                   // How long the process ran for, charged in sched()
   uint ctime;                   // When was the process created 
   uint etime;                   // When did the process exited
 
   int queue;                   // Which queue the process is in
   int entryTime;               // When the process entered the queue
   int timeRanInQueue;             // How long the process has been in the queue
+
+  // while the process sits on a run queue, these (and queue,
+  // entryTime, timeRanInQueue) are protected by the run queue's lock:
+  int onrq;                    // On cpus[cpu].rq, best-effort
+  struct proc *qnext;          // Next process in the same run queue
+  struct proc *qprev;          // Previous process in the same run queue
+  int rqlevel;                 // Level of the run queue it is on
+  uint64 pass;                 // Stride scheduler pass value
+  int heapidx;                 // Index in the run queue's stride heap
+  uint64 vruntime;             // CFS virtual runtime, in weighted cycles
+  int weight;                  // CFS load weight, fixed while queued
+  struct rbnode rbnode;        // Node in the run queue's CFS or EDF tree
+  struct proc *anext;          // Next process in the same MLFQ aging wheel slot
+  struct proc *aprev;          // Previous process in the same MLFQ aging wheel slot
+  uint agedue;                 // Tick at which it is due for MLFQ promotion
+  uint64 runstart;             // time CSR when the process last started running
+  uint64 charged;              // time CSR up to which charge() has charged it
+
+  // while the process sleeps it is on its channel's wait queue
+  // (see sleep() in proc.c); these are protected by that queue's lock:
+  struct waitq *wq;            // Wait queue it is on, if any
+  struct proc *wnext;          // Next process on the same wait queue
+  struct proc *wprev;          // Previous process on the same wait queue
+
+  // while the process waits for a sleeplock, this is protected
+  // by that sleeplock's spinlock:
+  struct proc *lknext;         // Next process waiting for the same sleeplock
+
+  // EDF reservation, in cycles; dl_runtime is 0 for best-effort processes.
+  uint64 dl_runtime;           // Budget per period
+  uint64 dl_period;            // Replenishment period
+  uint64 dl_deadline;          // Deadline, relative to the start of a period
+  uint64 dl_abs;               // Absolute deadline of the current period
+  int64 dl_budget;             // Budget left in the current period
+  uint64 dl_bw;                // Bandwidth reserved on cpu, for admission control
 };
+
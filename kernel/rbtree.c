@@ -0,0 +1,252 @@
+// Red-black trees, after CLRS chapter 13, with null
+// pointers for the leaves and a cached leftmost node
+// so that the smallest element is found in O(1).
+
+#include "types.h"
+#include "rbtree.h"
+
+static void
+rotate_left(struct rbroot *t, struct rbnode *x)
+{
+  struct rbnode *y = x->right;
+
+  x->right = y->left;
+  if(y->left)
+    y->left->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->left)
+    x->parent->left = y;
+  else
+    x->parent->right = y;
+  y->left = x;
+  x->parent = y;
+}
+
+static void
+rotate_right(struct rbroot *t, struct rbnode *x)
+{
+  struct rbnode *y = x->left;
+
+  x->left = y->right;
+  if(y->right)
+    y->right->parent = x;
+  y->parent = x->parent;
+  if(x->parent == 0)
+    t->root = y;
+  else if(x == x->parent->right)
+    x->parent->right = y;
+  else
+    x->parent->left = y;
+  y->right = x;
+  x->parent = y;
+}
+
+static int
+isred(struct rbnode *n)
+{
+  return n && n->red;
+}
+
+// Return the node after n in order, or 0.
+struct rbnode*
+rb_next(struct rbnode *n)
+{
+  if(n->right){
+    n = n->right;
+    while(n->left)
+      n = n->left;
+    return n;
+  }
+  while(n->parent && n == n->parent->right)
+    n = n->parent;
+  return n->parent;
+}
+
+// Insert n into t. less(a, b) says whether a sorts before b;
+// equal nodes go after the ones already in the tree.
+void
+rb_insert(struct rbroot *t, struct rbnode *n,
+          int (*less)(struct rbnode*, struct rbnode*))
+{
+  struct rbnode *parent = 0, **link = &t->root;
+  int leftmost = 1;
+
+  while(*link){
+    parent = *link;
+    if(less(n, parent)){
+      link = &parent->left;
+    } else {
+      link = &parent->right;
+      leftmost = 0;
+    }
+  }
+  n->parent = parent;
+  n->left = n->right = 0;
+  n->red = 1;
+  *link = n;
+  if(leftmost)
+    t->first = n;
+
+  // n is red; fix a red parent. the root is black, so a red
+  // parent always has a parent of its own.
+  while(n != t->root && n->parent->red){
+    struct rbnode *p = n->parent, *g = p->parent;
+    if(p == g->left){
+      struct rbnode *u = g->right;
+      if(isred(u)){
+        p->red = u->red = 0;
+        g->red = 1;
+        n = g;
+      } else {
+        if(n == p->right){
+          n = p;
+          rotate_left(t, n);
+          p = n->parent;
+        }
+        p->red = 0;
+        g->red = 1;
+        rotate_right(t, g);
+      }
+    } else {
+      struct rbnode *u = g->left;
+      if(isred(u)){
+        p->red = u->red = 0;
+        g->red = 1;
+        n = g;
+      } else {
+        if(n == p->left){
+          n = p;
+          rotate_right(t, n);
+          p = n->parent;
+        }
+        p->red = 0;
+        g->red = 1;
+        rotate_left(t, g);
+      }
+    }
+  }
+  t->root->red = 0;
+}
+
+// Put v where u was in u's parent.
+static void
+transplant(struct rbroot *t, struct rbnode *u, struct rbnode *v)
+{
+  if(u->parent == 0)
+    t->root = v;
+  else if(u == u->parent->left)
+    u->parent->left = v;
+  else
+    u->parent->right = v;
+  if(v)
+    v->parent = u->parent;
+}
+
+// x (possibly null) has one black too few; xp is its parent.
+static void
+erase_fixup(struct rbroot *t, struct rbnode *x, struct rbnode *xp)
+{
+  struct rbnode *w;
+
+  while(x != t->root && !isred(x)){
+    if(x == xp->left){
+      w = xp->right;
+      if(w->red){
+        w->red = 0;
+        xp->red = 1;
+        rotate_left(t, xp);
+        w = xp->right;
+      }
+      if(!isred(w->left) && !isred(w->right)){
+        w->red = 1;
+        x = xp;
+        xp = x->parent;
+      } else {
+        if(!isred(w->right)){
+          w->left->red = 0;
+          w->red = 1;
+          rotate_right(t, w);
+          w = xp->right;
+        }
+        w->red = xp->red;
+        xp->red = 0;
+        w->right->red = 0;
+        rotate_left(t, xp);
+        x = t->root;
+      }
+    } else {
+      w = xp->left;
+      if(w->red){
+        w->red = 0;
+        xp->red = 1;
+        rotate_right(t, xp);
+        w = xp->left;
+      }
+      if(!isred(w->left) && !isred(w->right)){
+        w->red = 1;
+        x = xp;
+        xp = x->parent;
+      } else {
+        if(!isred(w->left)){
+          w->right->red = 0;
+          w->red = 1;
+          rotate_left(t, w);
+          w = xp->left;
+        }
+        w->red = xp->red;
+        xp->red = 0;
+        w->left->red = 0;
+        rotate_right(t, xp);
+        x = t->root;
+      }
+    }
+  }
+  if(x)
+    x->red = 0;
+}
+
+// Remove z from t.
+void
+rb_erase(struct rbroot *t, struct rbnode *z)
+{
+  struct rbnode *y, *x, *xp;
+  int wasred = z->red;
+
+  if(t->first == z)
+    t->first = rb_next(z);
+
+  if(z->left == 0){
+    x = z->right;
+    xp = z->parent;
+    transplant(t, z, z->right);
+  } else if(z->right == 0){
+    x = z->left;
+    xp = z->parent;
+    transplant(t, z, z->left);
+  } else {
+    // replace z by its successor y.
+    y = z->right;
+    while(y->left)
+      y = y->left;
+    wasred = y->red;
+    x = y->right;
+    if(y->parent == z){
+      xp = y;
+    } else {
+      xp = y->parent;
+      transplant(t, y, y->right);
+      y->right = z->right;
+      y->right->parent = y;
+    }
+    transplant(t, z, y);
+    y->left = z->left;
+    y->left->parent = y;
+    y->red = z->red;
+  }
+  z->left = z->right = z->parent = 0;
+
+  if(!wasred)
+    erase_fixup(t, x, xp);
+}
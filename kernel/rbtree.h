@@ -0,0 +1,17 @@
+// Red-black trees. The nodes are embedded in the structures
+// being sorted; use rb_entry() to get back from a node to the
+// structure that contains it.
+struct rbnode {
+  struct rbnode *left;
+  struct rbnode *right;
+  struct rbnode *parent;
+  int red;
+};
+
+struct rbroot {
+  struct rbnode *root;
+  struct rbnode *first;   // leftmost (smallest) node, or 0 if empty
+};
+
+#define rb_entry(n, type, member) \
+  ((type*)((char*)(n) - __builtin_offsetof(type, member)))
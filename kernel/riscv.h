@@ -287,6 +287,14 @@ intr_get()
   return (x & SSTATUS_SIE) != 0;
 }
 
+// wait for an interrupt to become pending.
+// returns even if interrupts are disabled.
+static inline void
+wfi()
+{
+  asm volatile("wfi");
+}
+
 static inline uint64
 r_sp()
 {
@@ -0,0 +1,15 @@
+// CPU accounting for a process, from getrusage() and waitx().
+// Times are in cycles of the time CSR, which qemu's virt
+// machine counts at TIMEBASE_HZ; TIMERINTERVAL cycles make
+// one tick.
+#define TIMEBASE_HZ 10000000
+
+struct rusage {
+  uint64 ru_run;      // Running
+  uint64 ru_wait;     // Runnable, waiting for a cpu
+  uint64 ru_sleep;    // Sleeping
+  uint64 ru_elapsed;  // Since creation, up to exit for a child reaped by waitx
+  int ru_nswitch;     // Times scheduled
+  int ru_cowcopied;   // Copy-on-write faults that copied the page
+  int ru_cowreused;   // Copy-on-write faults that took over a page no one else had
+};
@@ -0,0 +1,1605 @@
+// Run queues and scheduling policies.
+//
+// Every hart has a run queue of RUNNABLE processes (struct runq
+// in proc.h). All the policies below are compiled in; each one
+// is a struct policy in policies[], and each run queue is kept
+// in the shape of one of them. setscheduler() makes another
+// policy the active one and re-sorts the run queues under it,
+// so the policy can be changed while processes are running.
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "sched.h"
+#include "cpustat.h"
+#include "schedtrace.h"
+#include "defs.h"
+
+extern struct proc proc[NPROC];
+
+// the policy the kernel boots with, from make SCHEDULER=...
+#if defined(FCFS)
+#define BOOTPOLICY SCHED_FCFS
+#elif defined(LBS)
+#define BOOTPOLICY SCHED_LBS
+#elif defined(PBS)
+#define BOOTPOLICY SCHED_PBS
+#elif defined(MLFQ)
+#define BOOTPOLICY SCHED_MLFQ
+#elif defined(STRIDE)
+#define BOOTPOLICY SCHED_STRIDE
+#elif defined(CFS)
+#define BOOTPOLICY SCHED_CFS
+#else
+#define BOOTPOLICY SCHED_RR
+#endif
+
+struct policy *schedpolicy;   // the active policy
+
+// Put p on level q of run queue rq, at the tail,
+// or at the head if front is set.
+static void
+rq_link(struct runq *rq, struct proc *p, int q, int front)
+{
+  p->rqlevel = q;
+  if(rq->head[q] == 0){
+    p->qnext = p->qprev = 0;
+    rq->head[q] = rq->tail[q] = p;
+  } else if(front){
+    p->qprev = 0;
+    p->qnext = rq->head[q];
+    rq->head[q]->qprev = p;
+    rq->head[q] = p;
+  } else {
+    p->qnext = 0;
+    p->qprev = rq->tail[q];
+    rq->tail[q]->qnext = p;
+    rq->tail[q] = p;
+  }
+  rq->nrunnable++;
+}
+
+static void
+rq_unlink(struct runq *rq, struct proc *p)
+{
+  int q = p->rqlevel;
+
+  if(p->qprev)
+    p->qprev->qnext = p->qnext;
+  else
+    rq->head[q] = p->qnext;
+  if(p->qnext)
+    p->qnext->qprev = p->qprev;
+  else
+    rq->tail[q] = p->qprev;
+  p->qnext = p->qprev = 0;
+  rq->nrunnable--;
+}
+
+static int
+always(struct runq *rq, struct proc *p)
+{
+  return 1;
+}
+
+static int
+never(struct runq *rq, struct proc *p)
+{
+  return 0;
+}
+
+static void
+nocharge(struct runq *rq, struct proc *p)
+{
+}
+
+//
+// Round Robin: one FIFO, preempted every tick.
+//
+
+static void
+fifo_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  rq_link(rq, p, 0, 0);
+}
+
+static void
+fifo_dequeue(struct runq *rq, struct proc *p)
+{
+  rq_unlink(rq, p);
+}
+
+static struct proc*
+rr_pick(struct runq *rq)
+{
+  return rq->head[0];
+}
+
+//
+// First Come First Serve: the oldest process runs until it
+// sleeps or exits.
+//
+
+static struct proc*
+fcfs_pick(struct runq *rq)
+{
+  struct proc *p, *best = 0;
+
+  for(p = rq->head[0]; p; p = p->qnext){
+    if(best == 0 || p->createTime < best->createTime)
+      best = p;
+  }
+  return best;
+}
+
+//
+// Priority Based: the lowest dynamic priority runs until it
+// sleeps or exits. Ties go to the process scheduled fewer
+// times, then to the older one.
+//
+
+// p's dynamic priority, or the one it has inherited
+// if that is more urgent.
+static int
+pbs_dp(struct proc *p)
+{
+  int dp = getDP(p);
+
+  return p->inherited < dp ? p->inherited : dp;
+}
+
+static struct proc*
+pbs_pick(struct runq *rq)
+{
+  struct proc *p, *best = 0;
+
+  for(p = rq->head[0]; p; p = p->qnext){
+    if(!best){
+      best = p;
+      continue;
+    }
+    int newDp = pbs_dp(p);
+    int maxDp = pbs_dp(best);
+    if(newDp < maxDp)
+      best = p;
+    else if(newDp == maxDp){
+      if(p->timesScheduled < best->timesScheduled)
+        best = p;
+      else if(p->timesScheduled == best->timesScheduled &&
+              p->createTime < best->createTime)
+        best = p;
+    }
+  }
+  return best;
+}
+
+//
+// Lottery Based: a random ticket is drawn among those held by
+// the queued processes, kept in a Fenwick tree by proc slot.
+//
+
+// Add n tickets to proc slot i in rq's Fenwick tree.
+static void
+lottery_add(struct runq *rq, int i, int n)
+{
+  rq->tickets += n;
+  for(i++; i <= NPROC; i += i & -i)
+    rq->fenwick[i] += n;
+}
+
+// Return the proc slot holding ticket number winner,
+// i.e. the first slot whose running sum of tickets
+// exceeds winner. O(log NPROC).
+static int
+lottery_find(struct runq *rq, int winner)
+{
+  int i = 0, step = 1;
+
+  while(step * 2 <= NPROC)
+    step *= 2;
+  for(; step > 0; step /= 2){
+    if(i + step <= NPROC && rq->fenwick[i + step] <= winner){
+      i += step;
+      winner -= rq->fenwick[i];
+    }
+  }
+  return i;
+}
+
+static void
+lbs_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  rq_link(rq, p, 0, 0);
+  lottery_add(rq, p - proc, p->tickets);
+}
+
+static void
+lbs_dequeue(struct runq *rq, struct proc *p)
+{
+  rq_unlink(rq, p);
+  lottery_add(rq, p - proc, -p->tickets);
+}
+
+static struct proc*
+lbs_pick(struct runq *rq)
+{
+  // rand() only gives 15 bits, so use two draws.
+  if(rq->tickets <= 0)
+    return 0;
+  int winner = ((rand() << 15) | rand()) % rq->tickets;
+  return &proc[lottery_find(rq, winner)];
+}
+
+//
+// Multi Level Feedback Queue: a FIFO per level. A process that
+// uses up its slice drops a level; one that waits too long at
+// a level is promoted.
+//
+
+// These can be tuned at run time with sysctl().
+
+// levels in use; processes go no lower than mlfq_levels - 1.
+int mlfq_levels = NQUEUE;
+
+// every mlfq_boost ticks, everything goes back to the top
+// level, so that a process whose behaviour has changed is
+// not stuck below; 0 turns this off.
+int mlfq_boost = 0;
+
+// time slice (in ticks) a process gets at each level
+// before it is demoted to the next one.
+int mlfq_slice[NQUEUE] = {1, 2, 4, 8, 16};
+
+// ticks a process may wait at each level before it
+// is promoted to the one above.
+int mlfq_agelimit[NQUEUE] = {0, 40, 30, 25, 20};
+
+// The level p is queued at: its own, or the one it has
+// inherited if that is higher.
+static int
+mlfq_level(struct proc *p)
+{
+  return p->inherited < p->queue ? p->inherited : p->queue;
+}
+
+// The tick of the most recent boost, or 0 if there are none.
+static uint
+mlfq_lastboost(void)
+{
+  int boost = mlfq_boost;
+
+  return boost ? ticks - ticks % boost : 0;
+}
+
+// Promote p once for every aging limit it has spent
+// waiting since it entered its level.
+// Returns 1 if p changed level.
+static int
+mlfq_age(struct proc *p)
+{
+  int q = p->queue;
+
+  while(p->queue > 0){
+    int limit = mlfq_agelimit[p->queue];
+    int waitTime = (int)(ticks - p->entryTime - p->timeRanInQueue);
+    if(waitTime < limit)
+      break;
+    // it became due at entryTime + timeRanInQueue + limit.
+    p->entryTime += p->timeRanInQueue + limit;
+    p->timeRanInQueue = 0;
+    p->queue--;
+  }
+  return p->queue != q;
+}
+
+// A queued process below the top level is on rq's aging wheel,
+// in the slot for the tick at which it is due for promotion.
+// The wheel has a slot per tick for MLFQ_WHEEL ticks and wraps
+// around, so a slot can also hold processes due a lap or more
+// later; they stay put until their tick comes round.
+static void
+mlfq_arm(struct runq *rq, struct proc *p)
+{
+  struct proc **slot;
+
+  if(p->queue == 0)
+    return;
+  p->agedue = p->entryTime + p->timeRanInQueue + mlfq_agelimit[p->queue];
+  slot = &rq->wheel[p->agedue % MLFQ_WHEEL];
+  p->aprev = 0;
+  p->anext = *slot;
+  if(*slot)
+    (*slot)->aprev = p;
+  *slot = p;
+  rq->naging++;
+}
+
+static void
+mlfq_disarm(struct runq *rq, struct proc *p)
+{
+  if(p->queue == 0)
+    return;
+  if(p->aprev)
+    p->aprev->anext = p->anext;
+  else
+    rq->wheel[p->agedue % MLFQ_WHEEL] = p->anext;
+  if(p->anext)
+    p->anext->aprev = p->aprev;
+  p->anext = p->aprev = 0;
+  rq->naging--;
+}
+
+static void
+mlfq_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  int front = 0, from = p->queue;
+  uint boost = mlfq_lastboost();
+
+  if(p->queue >= mlfq_levels)
+    p->queue = mlfq_levels - 1;
+  if(boost && p->queue > 0 && (int)(p->entryTime - boost) < 0){
+    // it has been at this level since before the last boost.
+    p->queue = 0;
+    p->entryTime = ticks;
+    p->timeRanInQueue = 0;
+  }
+
+  if(yielded && p->timeRanInQueue >= mlfq_slice[p->queue]){
+    // it has used up its time slice: drop a level and go
+    // to the back of that queue.
+    if(p->queue < mlfq_levels - 1)
+      p->queue++;
+    p->entryTime = ticks;
+    p->timeRanInQueue = 0;
+  } else if(yielded == YIELD_PREEMPTED){
+    // otherwise keep its place at the front of its level,
+    // unless it gave the cpu up itself.
+    front = 1;
+  }
+  // sleeping processes are not on any run queue, so they are
+  // aged when they come back; so is one that ran under another
+  // policy. the wheel only has what is due from now on.
+  if(mlfq_age(p))
+    front = 0;
+  rq_link(rq, p, mlfq_level(p), front);
+  mlfq_arm(rq, p);
+  if(p->queue != from)
+    schedevent(EV_QUEUE, p, p->queue);
+}
+
+static void
+mlfq_dequeue(struct runq *rq, struct proc *p)
+{
+  mlfq_disarm(rq, p);
+  rq_unlink(rq, p);
+}
+
+static struct proc*
+mlfq_pick(struct runq *rq)
+{
+  // the head of the highest non-empty level.
+  for(int q = 0; q < NQUEUE; q++){
+    if(rq->head[q])
+      return rq->head[q];
+  }
+  return 0;
+}
+
+// Turn rq's aging wheel up to the current tick, promoting the
+// processes that have come due on the way. Each tick's slot is
+// visited once, so this is O(1) per tick plus O(1) per promotion.
+// Caller must hold rq->lock.
+static void
+mlfq_advance(struct runq *rq)
+{
+  uint now = ticks;
+  uint boost = mlfq_lastboost();
+  struct proc *p, *pnext;
+
+  if(boost && rq->boosttick != boost){
+    // boost the processes queued here; the rest are boosted
+    // when they are next queued.
+    rq->boosttick = boost;
+    for(int q = 1; q < NQUEUE; q++){
+      while((p = rq->head[q]) != 0){
+        mlfq_disarm(rq, p);
+        rq_unlink(rq, p);
+        p->queue = 0;
+        p->entryTime = now;
+        p->timeRanInQueue = 0;
+        rq_link(rq, p, 0, 0);
+        schedevent(EV_QUEUE, p, 0);
+      }
+    }
+  }
+
+  if(rq->naging == 0 || now - rq->wheeltick > MLFQ_WHEEL){
+    // nothing to promote, or it has been a whole lap:
+    // visit every slot once.
+    if(rq->naging != 0)
+      rq->wheeltick = now - MLFQ_WHEEL;
+    else
+      rq->wheeltick = now;
+  }
+  while(rq->wheeltick != now){
+    rq->wheeltick++;
+    for(p = rq->wheel[rq->wheeltick % MLFQ_WHEEL]; p; p = pnext){
+      pnext = p->anext;
+      if((int)(p->agedue - now) > 0)
+        continue;    // due on a later lap
+      mlfq_disarm(rq, p);
+      rq_unlink(rq, p);
+      // might be more than one level if we are late.
+      mlfq_age(p);
+      rq_link(rq, p, mlfq_level(p), 0);
+      mlfq_arm(rq, p);
+      schedevent(EV_QUEUE, p, p->queue);
+    }
+  }
+}
+
+//
+// Stride: the queued process with the smallest pass runs next,
+// and its pass advances by a stride inversely proportional to
+// its tickets. The queue is a min-heap keyed by pass.
+//
+
+#define STRIDE1 (1 << 20)   // stride of a process holding a single ticket
+
+static void
+heap_swap(struct runq *rq, int i, int j)
+{
+  struct proc *t = rq->heap[i];
+
+  rq->heap[i] = rq->heap[j];
+  rq->heap[j] = t;
+  rq->heap[i]->heapidx = i;
+  rq->heap[j]->heapidx = j;
+}
+
+// Move the process at heap index i up to its place.
+static void
+heap_up(struct runq *rq, int i)
+{
+  while(i > 0 && rq->heap[i]->pass < rq->heap[(i-1)/2]->pass){
+    heap_swap(rq, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+// Move the process at heap index i down to its place.
+static void
+heap_down(struct runq *rq, int i)
+{
+  for(;;){
+    int l = 2*i + 1, r = l + 1, min = i;
+    if(l < rq->nheap && rq->heap[l]->pass < rq->heap[min]->pass)
+      min = l;
+    if(r < rq->nheap && rq->heap[r]->pass < rq->heap[min]->pass)
+      min = r;
+    if(min == i)
+      break;
+    heap_swap(rq, i, min);
+    i = min;
+  }
+}
+
+static void
+stride_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  rq_link(rq, p, 0, 0);
+  // a process that has been away (asleep, new, or on another
+  // queue) must not come back with a pass far behind everyone
+  // else's, or it would monopolize the cpu until it caught up.
+  if(p->pass < rq->pass)
+    p->pass = rq->pass;
+  p->heapidx = rq->nheap++;
+  rq->heap[p->heapidx] = p;
+  heap_up(rq, p->heapidx);
+}
+
+static void
+stride_dequeue(struct runq *rq, struct proc *p)
+{
+  int i = p->heapidx;
+
+  rq_unlink(rq, p);
+  if(i != --rq->nheap){
+    heap_swap(rq, i, rq->nheap);
+    heap_down(rq, i);
+    heap_up(rq, i);
+  }
+  p->heapidx = -1;
+}
+
+static struct proc*
+stride_pick(struct runq *rq)
+{
+  return rq->nheap ? rq->heap[0] : 0;
+}
+
+// Charge p its stride up front. rq's pass follows the smallest
+// pass among p and those still queued, since p may not have
+// been the pick if that was not allowed on this cpu.
+static void
+stride_dispatch(struct runq *rq, struct proc *p)
+{
+  uint64 pass = p->pass;
+
+  if(rq->nheap && rq->heap[0]->pass < pass)
+    pass = rq->heap[0]->pass;
+  if(pass > rq->pass)
+    rq->pass = pass;
+  p->pass += STRIDE1 / p->tickets;
+}
+
+//
+// Completely Fair: the queued process that has had the least
+// cpu time, weighted by priority, runs next. The queue is a
+// red-black tree keyed by vruntime.
+//
+
+// every runnable process on a hart should get to run at least
+// once per CFS_LATENCY cycles, but none is preempted before it
+// has run for CFS_MINGRAN.
+#define CFS_LATENCY (3 * TIMERINTERVAL)
+#define CFS_MINGRAN (TIMERINTERVAL / 4)
+#define NICE_0_WEIGHT 1024
+
+// load weight of each nice level from -20 to 19, as in Linux:
+// a process gets about 10% more cpu than one a level below it.
+static const int cfs_weights[40] = {
+  88761, 71755, 56483, 46273, 36291,
+  29154, 23254, 18705, 14949, 11916,
+   9548,  7620,  6100,  4904,  3906,
+   3121,  2501,  1991,  1586,  1277,
+   1024,   820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,    87,    70,    56,    45,
+     36,    29,    23,    18,    15,
+};
+
+// Load weight of p. Its PBS dynamic priority (0 to 100,
+// 60 by default) is mapped onto nice levels two points apart.
+static int
+cfs_weight(struct proc *p)
+{
+  int nice = (getDP(p) - 60) / 2;
+
+  if(nice < -20)
+    nice = -20;
+  if(nice > 19)
+    nice = 19;
+  return cfs_weights[nice + 20];
+}
+
+static int
+cfs_less(struct rbnode *a, struct rbnode *b)
+{
+  return rb_entry(a, struct proc, rbnode)->vruntime <
+         rb_entry(b, struct proc, rbnode)->vruntime;
+}
+
+static void
+cfs_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  rq_link(rq, p, 0, 0);
+  // a sleeper is credited with at most half a latency period.
+  if(p->vruntime + CFS_LATENCY / 2 < rq->min_vruntime)
+    p->vruntime = rq->min_vruntime - CFS_LATENCY / 2;
+  p->weight = cfs_weight(p);
+  rq->load += p->weight;
+  rb_insert(&rq->cfs, &p->rbnode, cfs_less);
+}
+
+static void
+cfs_dequeue(struct runq *rq, struct proc *p)
+{
+  rq_unlink(rq, p);
+  rb_erase(&rq->cfs, &p->rbnode);
+  rq->load -= p->weight;
+}
+
+static struct proc*
+cfs_pick(struct runq *rq)
+{
+  if(rq->cfs.first == 0)
+    return 0;
+  return rb_entry(rq->cfs.first, struct proc, rbnode);
+}
+
+// Move rq's min_vruntime up to the smallest vruntime among p
+// and those still queued, as in stride_dispatch().
+static void
+cfs_dispatch(struct runq *rq, struct proc *p)
+{
+  uint64 v = p->vruntime;
+  struct proc *first;
+
+  if(rq->cfs.first){
+    first = rb_entry(rq->cfs.first, struct proc, rbnode);
+    if(first->vruntime < v)
+      v = first->vruntime;
+  }
+  if(v > rq->min_vruntime)
+    rq->min_vruntime = v;
+}
+
+// Has p had its share of the latency target? With others
+// waiting on this hart it may run for CFS_LATENCY * weight /
+// total weight, but no less than CFS_MINGRAN.
+static int
+cfs_timeslice_over(struct runq *rq, struct proc *p)
+{
+  uint64 slice;
+  int w = cfs_weight(p);
+
+  if(rq->nrunnable == 0)
+    return 0;
+  slice = CFS_LATENCY * w / (rq->load + w);
+  if(slice < CFS_MINGRAN)
+    slice = CFS_MINGRAN;
+  return r_time() - p->runstart >= slice;
+}
+
+static struct policy policies[NSCHED] = {
+  [SCHED_RR]     { SCHED_RR, "Round Robin Scheduler",
+                   fifo_enqueue, fifo_dequeue, rr_pick, nocharge, always },
+  [SCHED_FCFS]   { SCHED_FCFS, "First Come First Serve Scheduler",
+                   fifo_enqueue, fifo_dequeue, fcfs_pick, nocharge, never },
+  [SCHED_LBS]    { SCHED_LBS, "Lottery Based Scheduler",
+                   lbs_enqueue, lbs_dequeue, lbs_pick, nocharge, always },
+  [SCHED_PBS]    { SCHED_PBS, "Priority Based Scheduler",
+                   fifo_enqueue, fifo_dequeue, pbs_pick, nocharge, never },
+  [SCHED_MLFQ]   { SCHED_MLFQ, "Multi Level Feedback Queue Scheduler",
+                   mlfq_enqueue, mlfq_dequeue, mlfq_pick, nocharge, always },
+  [SCHED_STRIDE] { SCHED_STRIDE, "Stride Scheduler",
+                   stride_enqueue, stride_dequeue, stride_pick,
+                   stride_dispatch, always },
+  [SCHED_CFS]    { SCHED_CFS, "Completely Fair Scheduler",
+                   cfs_enqueue, cfs_dequeue, cfs_pick, cfs_dispatch,
+                   cfs_timeslice_over },
+};
+
+//
+// EDF reservations. A process that has made one with
+// sched_setdeadline() is guaranteed dl_runtime cycles of cpu in
+// every dl_period, by its deadline, and runs ahead of every
+// best-effort process. Reservations are partitioned: each is
+// admitted onto one cpu, and the process stays on that cpu's
+// queue, out of reach of steal().
+//
+
+#define DL_UNIT (1L << 20)               // a whole cpu's worth of bandwidth
+#define DL_LIMIT (DL_UNIT * 95 / 100)    // leave some for best-effort processes
+#define DL_MAXPERIOD 1000                // ticks; keeps the products below in 64 bits
+
+static struct spinlock dl_lock;  // admission control; protects every rq.dl_bw
+
+static int
+dl_less(struct rbnode *a, struct rbnode *b)
+{
+  return rb_entry(a, struct proc, rbnode)->dl_abs <
+         rb_entry(b, struct proc, rbnode)->dl_abs;
+}
+
+// Queue a reserved process on rq: in deadline order if it has
+// budget left, otherwise on the throttled list until its next
+// period. yielded is clear if p is new or has just woken up.
+// Caller must hold rq->lock.
+static void
+dl_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  uint64 now = r_time();
+
+  // a waking process keeps its deadline only if it cannot use
+  // more than its reserved bandwidth by running its remaining
+  // budget before then (the CBS wake-up rule); otherwise it
+  // starts a fresh period now.
+  if(!yielded && (now >= p->dl_abs ||
+     (p->dl_budget > 0 && (uint64)p->dl_budget * p->dl_deadline >
+                          (p->dl_abs - now) * p->dl_runtime))){
+    p->dl_abs = now + p->dl_deadline;
+    p->dl_budget = p->dl_runtime;
+  }
+
+  if(p->dl_budget <= 0){
+    p->qnext = rq->dlthrottled;
+    rq->dlthrottled = p;
+    return;
+  }
+  rb_insert(&rq->dl, &p->rbnode, dl_less);
+}
+
+// Start a new period for every throttled process on rq whose
+// current period is over, and queue it again if that paid off
+// its overrun. Caller must hold rq->lock.
+static void
+dl_replenish(struct runq *rq)
+{
+  struct proc *p, **pp;
+  uint64 now;
+
+  if(rq->dlthrottled == 0)
+    return;
+  now = r_time();
+  for(pp = &rq->dlthrottled; (p = *pp) != 0; ){
+    if(now < p->dl_abs - p->dl_deadline + p->dl_period){
+      pp = &p->qnext;
+      continue;
+    }
+    p->dl_abs += p->dl_period;
+    p->dl_budget += p->dl_runtime;
+    if(p->dl_abs <= now){
+      // it has been throttled for more than a whole period.
+      p->dl_abs = now + p->dl_deadline;
+      p->dl_budget = p->dl_runtime;
+    }
+    if(p->dl_budget > (int64)p->dl_runtime)
+      p->dl_budget = p->dl_runtime;
+    if(p->dl_budget <= 0){
+      pp = &p->qnext;
+      continue;
+    }
+    *pp = p->qnext;
+    p->qnext = 0;
+    rb_insert(&rq->dl, &p->rbnode, dl_less);
+  }
+}
+
+// Give p a reservation of runtime ticks of cpu in every period
+// ticks, to be had within deadline ticks of the start of each
+// period, if some cpu has the bandwidth left for it. p moves to
+// that cpu's run queue the next time it is queued. A runtime of
+// 0 gives up p's reservation. Returns -1 if the parameters are
+// bad or no cpu can take the reservation; p keeps its old one.
+int
+setdeadline(struct proc *p, int runtime, int period, int deadline)
+{
+  struct cpu *c, *best = 0;
+  uint64 bw = 0;
+
+  if(runtime != 0){
+    if(runtime < 0 || runtime > deadline || deadline > period ||
+       period > DL_MAXPERIOD)
+      return -1;
+    // admit on density, runtime / deadline, which is enough for
+    // EDF to meet every deadline as long as a cpu's total is <= 1.
+    bw = ((uint64)runtime * DL_UNIT + deadline - 1) / deadline;
+  }
+
+  acquire(&dl_lock);
+  if(p->dl_bw)
+    cpus[p->cpu].rq.dl_bw -= p->dl_bw;
+  if(bw){
+    // the least loaded cpu that can take it.
+    for(c = cpus; c < &cpus[NCPU]; c++){
+      if(c->online && (p->affinity & (1L << (c - cpus))) &&
+         c->rq.dl_bw + bw <= DL_LIMIT &&
+         (best == 0 || c->rq.dl_bw < best->rq.dl_bw))
+        best = c;
+    }
+    if(best == 0){
+      if(p->dl_bw)
+        cpus[p->cpu].rq.dl_bw += p->dl_bw;
+      release(&dl_lock);
+      return -1;
+    }
+    best->rq.dl_bw += bw;
+  }
+  release(&dl_lock);
+
+  acquire(&p->lock);
+  // p is the caller: charge what it has run so far on its old
+  // terms, so that none of it comes out of the new budget.
+  charge(p);
+  p->dl_bw = bw;
+  p->dl_runtime = (uint64)runtime * TIMERINTERVAL;
+  p->dl_period = (uint64)period * TIMERINTERVAL;
+  p->dl_deadline = (uint64)deadline * TIMERINTERVAL;
+  if(best){
+    p->cpu = best - cpus;
+    p->dl_abs = r_time() + p->dl_deadline;
+    p->dl_budget = p->dl_runtime;
+  }
+  release(&p->lock);
+  return 0;
+}
+
+//
+// CPU bandwidth groups. Every process is in a group, group 0
+// unless setcpugroup() has put it elsewhere, and its children
+// start out in the same one. A group other than 0 can be given
+// a quota of cpu time per period with setcpuquota(); its
+// processes are charged against it wherever they run, and once
+// it is used up they are throttled, parked on the group instead
+// of a run queue, until the next period starts. Processes with
+// an EDF reservation are not throttled.
+//
+
+#define CG_MAXPERIOD 1000   // ticks
+
+struct cpugroup {
+  uint64 quota;             // cycles per period; 0 for no limit
+  uint period;              // ticks
+  uint nextrefill;          // tick at which the next period starts
+  int64 budget;             // cycles left in this period; updated atomically
+  struct proc *throttled;   // Parked until the next period, linked by qnext
+};
+
+static struct cpugroup groups[NCPUGROUP];
+static struct spinlock cg_lock;   // protects quota, period, nextrefill, throttled
+
+// Has p's group used up its quota?
+int
+cpugroupover(struct proc *p)
+{
+  struct cpugroup *g = &groups[p->group];
+
+  return p->group != 0 && p->dl_runtime == 0 && g->quota != 0 && g->budget <= 0;
+}
+
+// Park p on its group if the group is out of budget.
+// Returns 1 if it did. Caller must hold p->lock.
+static int
+cg_park(struct proc *p)
+{
+  struct cpugroup *g = &groups[p->group];
+
+  if(!cpugroupover(p))
+    return 0;
+  acquire(&cg_lock);
+  // the period may have just been refilled.
+  if(!cpugroupover(p)){
+    release(&cg_lock);
+    return 0;
+  }
+  p->qnext = g->throttled;
+  g->throttled = p;
+  release(&cg_lock);
+  return 1;
+}
+
+// Queue the processes parked on g again; those whose group
+// is still out of budget park again.
+static void
+cg_unpark(struct cpugroup *g)
+{
+  struct proc *p, *next;
+
+  acquire(&cg_lock);
+  p = g->throttled;
+  g->throttled = 0;
+  release(&cg_lock);
+
+  for(; p; p = next){
+    acquire(&p->lock);
+    next = p->qnext;
+    p->qnext = 0;
+    rq_add(p, 0);
+    release(&p->lock);
+  }
+}
+
+// Give group gid quota ticks of cpu in every period ticks;
+// quota can be more than period on a machine with more than
+// one cpu. A quota of 0 lifts the limit.
+// Returns -1 if the parameters are bad.
+int
+setcpuquota(int gid, int quota, int period)
+{
+  struct cpugroup *g;
+
+  if(gid <= 0 || gid >= NCPUGROUP || quota < 0 ||
+     (quota != 0 && (period <= 0 || period > CG_MAXPERIOD ||
+                     quota > NCPU * period)))
+    return -1;
+  g = &groups[gid];
+  acquire(&cg_lock);
+  g->quota = (uint64)quota * TIMERINTERVAL;
+  g->period = period;
+  g->budget = g->quota;
+  g->nextrefill = ticks + period;
+  release(&cg_lock);
+  // anything parked under the old quota can go now.
+  cg_unpark(g);
+  return 0;
+}
+
+// Move p to group gid. Returns its old group, or -1 if there
+// is no group gid. Caller must hold p->lock.
+int
+setcpugroup(struct proc *p, int gid)
+{
+  int old = p->group;
+
+  if(gid < 0 || gid >= NCPUGROUP)
+    return -1;
+  p->group = gid;
+  return old;
+}
+
+// Called on every tick by hart 0, with no locks held: start a
+// new period for every group whose period is over.
+void
+cpugrouptick(void)
+{
+  struct cpugroup *g;
+
+  for(g = &groups[1]; g < &groups[NCPUGROUP]; g++){
+    if(g->quota == 0 || (int)(ticks - g->nextrefill) < 0)
+      continue;
+    acquire(&cg_lock);
+    if(g->quota == 0 || (int)(ticks - g->nextrefill) < 0){
+      release(&cg_lock);
+      continue;
+    }
+    // an overrun from the last period is paid off first, and
+    // budget left over is not carried forward.
+    int64 add = g->quota;
+    if(g->budget + add > (int64)g->quota)
+      add = g->quota - g->budget;
+    __sync_fetch_and_add(&g->budget, add);
+    g->nextrefill += g->period;
+    if((int)(ticks - g->nextrefill) >= 0)
+      g->nextrefill = ticks + g->period;
+    release(&cg_lock);
+    cg_unpark(g);
+  }
+}
+
+// Re-sort the processes on rq under the active policy,
+// if rq is still organized by another one.
+// Caller must hold rq->lock.
+static void
+rq_migrate(struct runq *rq)
+{
+  struct proc *p, *head = 0, *tail = 0;
+  struct policy *to = schedpolicy;
+
+  if(rq->policy == to)
+    return;
+
+  // take everything off under the old policy, in queue order...
+  for(int q = 0; q < NQUEUE; q++){
+    while((p = rq->head[q]) != 0){
+      rq->policy->dequeue(rq, p);
+      if(tail)
+        tail->qnext = p;
+      else
+        head = p;
+      tail = p;
+    }
+  }
+
+  // ...and put it back under the new one.
+  rq->policy = to;
+  while((p = head) != 0){
+    head = p->qnext;
+    p->qnext = 0;
+    to->enqueue(rq, p, 0);
+  }
+}
+
+// Put best-effort process p on rq under rq's policy, and off
+// it again. These keep p->onrq and rq->nallowed[], the number
+// of queued processes allowed to run on each cpu, up to date.
+// Caller must hold rq->lock.
+static void
+rq_enqueue(struct runq *rq, struct proc *p, int yielded)
+{
+  rq_migrate(rq);
+  rq->policy->enqueue(rq, p, yielded);
+  p->onrq = 1;
+  for(int i = 0; i < NCPU; i++)
+    if(p->affinity & (1L << i))
+      rq->nallowed[i]++;
+}
+
+static void
+rq_dequeue(struct runq *rq, struct proc *p)
+{
+  rq->policy->dequeue(rq, p);
+  p->onrq = 0;
+  for(int i = 0; i < NCPU; i++)
+    if(p->affinity & (1L << i))
+      rq->nallowed[i]--;
+}
+
+// Take the next process to run on cpu id off rq and charge
+// it for being dispatched: the one the policy picks, unless
+// it may not run on id, in which case the first one in queue
+// order that may. Returns 0 if there is none.
+// Caller must hold rq->lock.
+static struct proc*
+rq_take(struct runq *rq, int id)
+{
+  struct proc *p;
+
+  rq_migrate(rq);
+  if(rq->nallowed[id] == 0)
+    return 0;
+  p = rq->policy->pick(rq);
+  if(p == 0 || !(p->affinity & (1L << id))){
+    p = 0;
+    for(int q = 0; q < NQUEUE && p == 0; q++)
+      for(p = rq->head[q]; p && !(p->affinity & (1L << id)); p = p->qnext)
+        ;
+    if(p == 0)
+      return 0;
+  }
+  rq_dequeue(rq, p);
+  rq->policy->dispatch(rq, p);
+  return p;
+}
+
+void
+schedinit(void)
+{
+  struct cpu *c;
+
+  initlock(&dl_lock, "dl");
+  initlock(&cg_lock, "cpugroup");
+  schedpolicy = &policies[BOOTPOLICY];
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    initlock(&c->rq.lock, "runq");
+    c->rq.policy = schedpolicy;
+  }
+}
+
+// Find an idle cpu for p to run on and claim it, so that the
+// next process to become runnable goes to another one: p's
+// own cpu if that is idle, otherwise any idle cpu, unless p
+// has a reservation and so must stay where it is.
+// Returns 0 if there is none.
+static struct cpu*
+claimidle(struct proc *p)
+{
+  struct cpu *c = &cpus[p->cpu];
+
+  if(c->idle && (p->affinity & (1L << p->cpu)) &&
+     __sync_bool_compare_and_swap(&c->idle, 1, 0))
+    return c;
+  if(p->dl_runtime)
+    return 0;
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    if(c->idle && (p->affinity & (1L << (c - cpus))) &&
+       __sync_bool_compare_and_swap(&c->idle, 1, 0))
+      return c;
+  }
+  return 0;
+}
+
+// The online cpu in p's affinity mask with the shortest queue.
+static int
+allowedcpu(struct proc *p)
+{
+  struct cpu *c, *best = 0;
+
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    if(c->online && (p->affinity & (1L << (c - cpus))) &&
+       (best == 0 || c->rq.nrunnable < best->rq.nrunnable))
+      best = c;
+  }
+  return best ? best - cpus : p->cpu;
+}
+
+// Put p on the run queue of the CPU it last ran on, or of an
+// idle CPU if it has just become runnable and one is idle;
+// either way one that p's affinity mask allows. If p's cpu
+// group is out of budget, park it on the group instead.
+// An idle CPU that p is queued on is woken up.
+// yielded is set if p was running until now.
+// Caller must hold p->lock.
+void
+rq_add(struct proc *p, int yielded)
+{
+  struct cpu *c;
+  struct runq *rq;
+
+  if(cg_park(p))
+    return;
+  c = yielded ? 0 : claimidle(p);
+  if(c)
+    p->cpu = c - cpus;
+  else if(!(p->affinity & (1L << p->cpu)))
+    p->cpu = allowedcpu(p);
+  rq = &cpus[p->cpu].rq;
+
+  acquire(&rq->lock);
+  if(p->dl_runtime)
+    dl_enqueue(rq, p, yielded);
+  else
+    rq_enqueue(rq, p, yielded);
+  release(&rq->lock);
+
+  // p may be on another cpu's queue without having claimed it:
+  // it yielded, or that cpu was busy a moment ago, and p had to
+  // move there for its affinity or reservation, or it last ran
+  // there. if that cpu has gone idle since, it looked at its
+  // queue before p was on it, so claim it and wake it up now.
+  if(c == 0){
+    push_off();
+    if(p->cpu != cpuid() &&
+       __sync_bool_compare_and_swap(&cpus[p->cpu].idle, 1, 0))
+      c = &cpus[p->cpu];
+    pop_off();
+  }
+
+  // the idle cpu won't look at its queue until it is interrupted.
+  if(c)
+    ipi(c - cpus);
+}
+
+// Take the last process in queue order that may run on cpu
+// id off rq, or 0 if there is none: the one that would have
+// had to wait longest, and so the best one to move.
+// Caller must hold rq->lock.
+static struct proc*
+rq_takelast(struct runq *rq, int id)
+{
+  struct proc *p = 0;
+
+  rq_migrate(rq);
+  for(int q = NQUEUE - 1; q >= 0 && p == 0; q--)
+    for(p = rq->tail[q]; p && !(p->affinity & (1L << id)); p = p->qprev)
+      ;
+  if(p)
+    rq_dequeue(rq, p);
+  return p;
+}
+
+// The min_vruntime of c's queue, where a process moved there
+// is placed. It is read under the queue's lock, since the cpu
+// that owns it updates it; the caller must hold no other run
+// queue's lock.
+static uint64
+min_vruntime(struct cpu *c)
+{
+  uint64 v;
+
+  acquire(&c->rq.lock);
+  v = c->rq.min_vruntime;
+  release(&c->rq.lock);
+  return v;
+}
+
+// Take a process that may run on c from whichever other CPU's
+// run queue has the most such processes.
+// Returns 0 if there is nothing to steal.
+static struct proc*
+steal(struct cpu *c)
+{
+  struct cpu *o, *victim = 0;
+  struct proc *p;
+  int id = c - cpus;
+  int most = 0;
+  uint64 minv;
+
+  // nallowed is only a hint here; rq_take() decides under the lock.
+  for(o = cpus; o < &cpus[NCPU]; o++){
+    if(o != c && o->rq.nallowed[id] > most){
+      most = o->rq.nallowed[id];
+      victim = o;
+    }
+  }
+  if(victim == 0)
+    return 0;
+
+  minv = min_vruntime(c);
+  acquire(&victim->rq.lock);
+  p = rq_take(&victim->rq, id);
+  // a vruntime only means something relative to its own queue.
+  if(p && victim->rq.policy->id == SCHED_CFS)
+    p->vruntime = minv;
+  release(&victim->rq.lock);
+  if(p){
+    c->nmigrated++;
+    schedevent(EV_MIGRATE, p, victim - cpus);
+  }
+  return p;
+}
+
+#define BALANCE_TICKS 4   // how often each busy cpu balances
+#define BALANCE_MAX 4     // the most processes it pulls at a time
+
+// Even out run queue lengths: while another cpu has at least
+// two more processes waiting than c, and some of them may run
+// on c, pull the last of those over to c. Idle cpus don't need
+// this, they steal; this is for cpus that are all busy, but
+// some with much longer queues than others.
+// Called with no locks held.
+static void
+balance(struct cpu *c)
+{
+  int id = c - cpus;
+  struct cpu *o, *victim;
+  struct proc *p;
+
+  for(int n = 0; n < BALANCE_MAX; n++){
+    // the counts are only a hint here, as in steal().
+    int most = 1;
+    victim = 0;
+    for(o = cpus; o < &cpus[NCPU]; o++){
+      int diff = o->rq.nrunnable - c->rq.nrunnable;
+      if(o != c && o->rq.nallowed[id] > 0 && diff > most){
+        most = diff;
+        victim = o;
+      }
+    }
+    if(victim == 0)
+      return;
+
+    uint64 minv = min_vruntime(c);
+    acquire(&victim->rq.lock);
+    p = rq_takelast(&victim->rq, id);
+    if(p && victim->rq.policy->id == SCHED_CFS)
+      p->vruntime = minv;
+    release(&victim->rq.lock);
+    if(p == 0)
+      return;
+
+    acquire(&p->lock);
+    p->cpu = id;
+    rq_add(p, 0);
+    release(&p->lock);
+    c->nmigrated++;
+    schedevent(EV_MIGRATE, p, victim - cpus);
+  }
+}
+
+// Choose the next process for cpu c to run and take it off
+// its run queue: the reserved process with the earliest
+// deadline, or else a best-effort process from c's own queue,
+// or else one stolen from the busiest other cpu.
+// Returns 0 if there is nothing to run.
+struct proc*
+pickproc(struct cpu *c)
+{
+  struct proc *p;
+
+  acquire(&c->rq.lock);
+  dl_replenish(&c->rq);
+  if(c->rq.dl.first){
+    p = rb_entry(c->rq.dl.first, struct proc, rbnode);
+    rb_erase(&c->rq.dl, &p->rbnode);
+    release(&c->rq.lock);
+    return p;
+  }
+  if(c->next){
+    // handed over by yield_to().
+    p = c->next;
+    c->next = 0;
+    release(&c->rq.lock);
+    return p;
+  }
+  rq_migrate(&c->rq);
+  if(c->rq.policy->id == SCHED_MLFQ)
+    mlfq_advance(&c->rq);
+  p = rq_take(&c->rq, c - cpus);
+  release(&c->rq.lock);
+  if(p == 0)
+    p = steal(c);
+  return p;
+}
+
+// Charge the running process p for the cpu time since it
+// was last charged: against its reservation, if it has one,
+// against its cpu group's quota, and to its vruntime, scaled down by its weight. vruntime is
+// kept whatever the policy, so that it is meaningful if CFS is
+// switched on later. Must be done before p goes back on a run
+// queue, since the trees are ordered by what is charged here.
+// Caller must hold p->lock.
+void
+charge(struct proc *p)
+{
+  uint64 now = r_time();
+
+  p->vruntime += (now - p->charged) * NICE_0_WEIGHT / cfs_weight(p);
+  if(p->dl_runtime)
+    p->dl_budget -= now - p->charged;
+  if(p->group)
+    __sync_fetch_and_sub(&groups[p->group].budget, now - p->charged);
+  p->charged = now;
+}
+
+// Called by cpu c's scheduler when it has found nothing to
+// run: wait for an interrupt instead of spinning. A cpu that
+// makes a process runnable claims an idle cpu and sends it an
+// IPI (see rq_add()). While idle, the cpu's timer is turned off,
+// except on hart 0, which keeps ticks, and while reserved
+// processes here wait for their next period.
+// Returns with interrupts off.
+void
+idle(struct cpu *c)
+{
+  int id = c - cpus;
+  int tickless;
+
+  intr_off();
+  c->idle = 1;
+  __sync_synchronize();
+
+  // check again now that the flag is visible: anything that
+  // was queued before then came without an IPI. interrupts are
+  // off, so an IPI that arrives from here on stays pending and
+  // wfi returns at once.
+  int work = c->rq.nrunnable > 0 || c->rq.dl.first != 0;
+  for(struct cpu *o = cpus; o < &cpus[NCPU] && !work; o++)
+    work = o->rq.nallowed[id] > 0;
+  if(work){
+    c->idle = 0;
+    return;
+  }
+
+  tickless = id != 0 && c->rq.dlthrottled == 0;
+  if(tickless)
+    *(uint64*)CLINT_MTIMECMP(id) = -1;
+  uint64 start = r_time();
+  wfi();
+  c->idletime += r_time() - start;
+  if(tickless)
+    *(uint64*)CLINT_MTIMECMP(id) = r_time() + TIMERINTERVAL;
+  c->idle = 0;
+}
+
+// Called on every cpu's timer interrupt, by the running
+// process: charge it, and say whether it should give up the
+// cpu. A reserved process that is ready to run preempts any
+// best-effort process and any reserved one with a later
+// deadline; a reserved process runs until it is out of budget.
+int
+schedtick(void)
+{
+  struct proc *p = myproc();
+  struct runq *rq;
+  struct cpu *c;
+  int id, preempt = 0;
+
+  push_off();
+  id = cpuid();
+  c = mycpu();
+  rq = &c->rq;
+  pop_off();
+
+  // its affinity has been changed to exclude this cpu.
+  if(!(p->affinity & (1L << id)))
+    return 1;
+
+  acquire(&p->lock);
+  charge(p);
+  release(&p->lock);
+
+  // its group is out of cpu time.
+  if(cpugroupover(p))
+    return 1;
+
+  if(ticks - c->lastbalance >= BALANCE_TICKS){
+    c->lastbalance = ticks;
+    balance(c);
+  }
+
+  acquire(&rq->lock);
+  dl_replenish(rq);
+  if(rq->dl.first){
+    struct proc *next = rb_entry(rq->dl.first, struct proc, rbnode);
+    preempt = p->dl_runtime == 0 || next->dl_abs < p->dl_abs;
+  }
+  release(&rq->lock);
+
+  if(preempt)
+    return 1;
+  if(p->dl_runtime)
+    return p->dl_budget <= 0;
+  return rq->policy->timeslice_over(rq, p);
+}
+
+// The online cpus, as an affinity mask.
+static uint64
+onlinecpus(void)
+{
+  uint64 mask = 0;
+
+  for(int i = 0; i < NCPU; i++)
+    if(cpus[i].online)
+      mask |= 1L << i;
+  return mask;
+}
+
+// Allow p to run only on the cpus in mask. A queued process
+// is moved to an allowed cpu's queue at once; a running one
+// gives up its cpu at the next tick if that is not allowed.
+// Returns -1 if mask has no online cpu, or if p has an EDF
+// reservation and mask leaves out the cpu it is on.
+// Caller must hold p->lock.
+int
+setaffinity(struct proc *p, uint64 mask)
+{
+  struct runq *rq;
+  int queued = 0;
+
+  mask &= (1L << NCPU) - 1;
+  if((mask & onlinecpus()) == 0)
+    return -1;
+  if(p->dl_runtime && !(mask & (1L << p->cpu)))
+    return -1;
+
+  // nallowed[] counts by the mask, so take p off its queue
+  // while the mask changes. it can't be queued again meanwhile,
+  // since that takes p->lock.
+  if(p->state == RUNNABLE && !p->dl_runtime){
+    rq = &cpus[p->cpu].rq;
+    acquire(&rq->lock);
+    if(p->onrq){
+      rq_migrate(rq);
+      rq_dequeue(rq, p);
+      queued = 1;
+    }
+    release(&rq->lock);
+  }
+  p->affinity = mask;
+  if(queued)
+    rq_add(p, 0);
+  return 0;
+}
+
+// p's affinity mask, less the cpus that are not online.
+// Caller must hold p->lock.
+uint64
+getaffinity(struct proc *p)
+{
+  return p->affinity & onlinecpus();
+}
+
+// Priority inheritance: a process waiting for a sleeplock lends
+// the holder its rank (see sleeplock.c), and PBS and MLFQ treat
+// the holder as if it had the most urgent rank lent to it, in
+// p->inherited. The other policies have no priorities to lend.
+
+int sched_inherit = 1;   // sysctl sched.inherit
+
+// How urgent p is under the active policy, counting what it
+// has inherited itself: its PBS dynamic priority or MLFQ level.
+// Lower is more urgent; NOINHERIT if there is nothing to lend.
+int
+schedrank(struct proc *p)
+{
+  if(!sched_inherit)
+    return NOINHERIT;
+  switch(schedpolicy->id){
+  case SCHED_PBS:
+    return pbs_dp(p);
+  case SCHED_MLFQ:
+    return mlfq_level(p);
+  }
+  return NOINHERIT;
+}
+
+// Set the rank p has inherited, and re-sort it
+// if it is queued. Caller must hold p->lock.
+void
+setinherited(struct proc *p, int rank)
+{
+  struct runq *rq;
+  int queued = 0;
+
+  if(p->inherited == rank)
+    return;
+  // take p off its queue while its level may change.
+  if(p->state == RUNNABLE && !p->dl_runtime){
+    rq = &cpus[p->cpu].rq;
+    acquire(&rq->lock);
+    if(p->onrq){
+      rq_migrate(rq);
+      rq_dequeue(rq, p);
+      queued = 1;
+    }
+    release(&rq->lock);
+  }
+  p->inherited = rank;
+  if(queued)
+    rq_add(p, 0);
+}
+
+// Make p the next process this cpu runs, ahead of the ones its
+// policy would pick, for yield_to(). p must be queued, without
+// an EDF reservation, and allowed on this cpu; it is taken off
+// its queue, which may be another cpu's.
+// Returns -1 if p can't be handed the cpu.
+// Caller must hold p->lock.
+int
+handoff(struct proc *p)
+{
+  struct cpu *c;
+  struct runq *rq;
+  uint64 minv;
+  int ok = 0;
+
+  push_off();
+  c = mycpu();
+  if(p->state == RUNNABLE && !p->dl_runtime && c->next == 0 &&
+     (p->affinity & (1L << cpuid()))){
+    rq = &cpus[p->cpu].rq;
+    minv = min_vruntime(c);
+    acquire(&rq->lock);
+    if(p->onrq){
+      rq_migrate(rq);
+      rq_dequeue(rq, p);
+      rq->policy->dispatch(rq, p);
+      // as in steal().
+      if(rq != &c->rq && rq->policy->id == SCHED_CFS)
+        p->vruntime = minv;
+      ok = 1;
+    }
+    release(&rq->lock);
+  }
+  if(ok)
+    c->next = p;
+  pop_off();
+  return ok ? 0 : -1;
+}
+
+// Copy every cpu's statistics into st[0..NCPU-1]. They are
+// read without locks, so they may be a little out of step
+// with each other.
+void
+cpustats(struct cpustat *st)
+{
+  uint64 now = r_time();
+
+  for(int i = 0; i < NCPU; i++){
+    struct cpu *c = &cpus[i];
+    st[i].online = c->online;
+    st[i].nrunnable = c->rq.nrunnable;
+    st[i].nswitch = c->nswitch;
+    st[i].nmigrated = c->nmigrated;
+    st[i].busy = c->busy;
+    st[i].idle = c->idletime;
+    st[i].elapsed = c->online ? now - c->start : 0;
+  }
+}
+
+// Make policy id the active one, and re-sort every run queue
+// under it. Ranks lent under the old policy are dropped.
+// Returns the previous policy, or -1 if id is not a policy.
+// A negative id just returns the active policy.
+int
+setscheduler(int id)
+{
+  struct policy *old = schedpolicy;
+  struct cpu *c;
+  struct proc *p;
+
+  if(id < 0)
+    return old->id;
+  if(id >= NSCHED)
+    return -1;
+
+  schedpolicy = &policies[id];
+  __sync_synchronize();
+  // run queues would also catch up the next time they are
+  // used, but an idle hart's queue might not be used for a while.
+  for(c = cpus; c < &cpus[NCPU]; c++){
+    acquire(&c->rq.lock);
+    rq_migrate(&c->rq);
+    release(&c->rq.lock);
+  }
+
+  // a rank means something else under another policy: MLFQ
+  // level 0 would be PBS priority 0 and outrank everything.
+  // the holders run at their own rank until waiters lend
+  // them one again.
+  if(schedpolicy != old){
+    for(p = proc; p < &proc[NPROC]; p++){
+      acquire(&p->lock);
+      if(p->inherited != NOINHERIT)
+        setinherited(p, NOINHERIT);
+      release(&p->lock);
+    }
+  }
+  return old->id;
+}
@@ -0,0 +1,9 @@
+// Scheduling policies, for setscheduler().
+#define SCHED_RR      0  // Round Robin
+#define SCHED_FCFS    1  // First Come First Serve
+#define SCHED_LBS     2  // Lottery Based Scheduler
+#define SCHED_PBS     3  // Priority Based Scheduler
+#define SCHED_MLFQ    4  // Multi Level Feedback Queue
+#define SCHED_STRIDE  5  // Stride Scheduler
+#define SCHED_CFS     6  // Completely Fair Scheduler
+#define NSCHED        7
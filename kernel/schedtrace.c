@@ -0,0 +1,113 @@
+// Scheduler event tracing. Each cpu records the events that
+// happen on it in a ring of its own, with interrupts off, so
+// recording takes no lock: a ring has one writer, its cpu, and
+// one reader, schedtrace(), which moves tail up to head. Events
+// are only recorded while the sched.trace sysctl is set; when a
+// ring is full, new events are dropped and counted.
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "schedtrace.h"
+#include "defs.h"
+
+#define NTRACE 1024           // events per cpu; a power of two
+
+struct ring {
+  struct schedev ev[NTRACE];
+  uint head;                  // next slot to write; only its cpu changes it
+  uint tail;                  // next slot to read; only schedtrace() changes it
+  int dropped;                // events lost because the ring was full
+};
+
+static struct ring rings[NCPU];
+
+int schedtrace_on;            // sysctl sched.trace
+
+// serializes readers.
+static struct spinlock trace_lock;
+
+void
+schedtraceinit(void)
+{
+  initlock(&trace_lock, "schedtrace");
+}
+
+// Record an event of the given type for p on this cpu.
+void
+schedevent(int type, struct proc *p, int arg)
+{
+  struct ring *r;
+  struct schedev *e;
+  uint h;
+  int id;
+
+  if(!schedtrace_on)
+    return;
+  push_off();
+  id = cpuid();
+  r = &rings[id];
+  h = r->head;
+  if(h - r->tail >= NTRACE){
+    __sync_fetch_and_add(&r->dropped, 1);
+    pop_off();
+    return;
+  }
+  e = &r->ev[h % NTRACE];
+  e->time = r_time();
+  e->pid = p->pid;
+  e->cpu = id;
+  e->type = type;
+  e->arg = arg;
+  // the event must be complete before the reader can see it.
+  __sync_synchronize();
+  r->head = h + 1;
+  pop_off();
+}
+
+// Move up to n events, oldest first on each cpu, into the
+// user buffer at addr, and return how many there were.
+// Returns -1 if the copy fails.
+int
+schedtrace(uint64 addr, int n)
+{
+  struct proc *p = myproc();
+  struct ring *r;
+  struct schedev e;
+  int got = 0;
+
+  acquire(&trace_lock);
+  for(r = rings; r < &rings[NCPU] && got < n; r++){
+    if(r->dropped){
+      e.time = r_time();
+      e.pid = 0;
+      e.cpu = r - rings;
+      e.type = EV_DROPPED;
+      e.arg = __sync_lock_test_and_set(&r->dropped, 0);
+      if(copyout(p->pagetable, addr + got * sizeof(e), (char*)&e, sizeof(e)) < 0){
+        release(&trace_lock);
+        return -1;
+      }
+      got++;
+    }
+    uint h = r->head;
+    // don't read events older than the head we saw.
+    __sync_synchronize();
+    while(r->tail != h && got < n){
+      e = r->ev[r->tail % NTRACE];
+      if(copyout(p->pagetable, addr + got * sizeof(e), (char*)&e, sizeof(e)) < 0){
+        release(&trace_lock);
+        return -1;
+      }
+      // done with the slot before the writer may reuse it.
+      __sync_synchronize();
+      r->tail++;
+      got++;
+    }
+  }
+  release(&trace_lock);
+  return got;
+}
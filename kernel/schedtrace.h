@@ -0,0 +1,16 @@
+// Scheduler events, from schedtrace().
+#define EV_SWITCHIN   0  // started running; arg is its MLFQ level
+#define EV_SWITCHOUT  1  // stopped running; arg is its new state
+#define EV_WAKEUP     2  // became runnable; arg is the cpu it was queued on
+#define EV_QUEUE      3  // changed MLFQ level; arg is the new level
+#define EV_MIGRATE    4  // pulled off another cpu's queue; arg is that cpu
+#define EV_DROPPED    5  // arg events were lost on this cpu; pid is 0
+#define NEV           6
+
+struct schedev {
+  uint64 time;        // time CSR
+  int pid;
+  char cpu;           // cpu it happened on
+  char type;          // EV_*
+  short arg;
+};
@@ -1,4 +1,12 @@
 // Sleeping locks
+//
+// A process that has to wait for a sleeplock lends its rank
+// under PBS or MLFQ (see schedrank()) to the process holding
+// it, so that a low-priority holder is not kept off the cpu
+// by everything ranked between it and the waiter. The holder
+// keeps the most urgent rank lent to it until it releases the
+// lock; only the holder is boosted, not whatever it may in
+// turn be waiting for.
 
 #include "types.h"
 #include "riscv.h"
@@ -6,6 +14,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "sleeplock.h"
 
@@ -16,28 +25,96 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->owner = 0;
+  lk->waiters = 0;
+  lk->nextheld = 0;
+}
+
+// Lend p's rank to the holder of lk, if that makes it more
+// urgent. Caller must hold lk->lk.
+static void
+lend(struct sleeplock *lk, struct proc *p)
+{
+  struct proc *owner = lk->owner;
+  int rank = schedrank(p);
+
+  if(owner == 0 || rank >= owner->inherited)
+    return;
+  acquire(&owner->lock);
+  if(rank < owner->inherited)
+    setinherited(owner, rank);
+  release(&owner->lock);
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+  struct proc **pp;
+
   acquire(&lk->lk);
-  while (lk->locked) {
-    sleep(lk, &lk->lk);
+  if(lk->locked){
+    p->lknext = lk->waiters;
+    lk->waiters = p;
+    while (lk->locked) {
+      // the owner may have changed since we last looked.
+      lend(lk, p);
+      sleep(lk, &lk->lk);
+    }
+    for(pp = &lk->waiters; *pp != p; pp = &(*pp)->lknext)
+      ;
+    *pp = p->lknext;
   }
   lk->locked = 1;
-  lk->pid = myproc()->pid;
+  lk->pid = p->pid;
+  lk->owner = p;
+  lk->nextheld = p->held;
+  p->held = lk;
   release(&lk->lk);
 }
 
 void
 releasesleep(struct sleeplock *lk)
 {
+  struct proc *p = myproc();
+  struct sleeplock **lp, *h;
+  struct proc *w;
+  int rank, was;
+
   acquire(&lk->lk);
+  for(lp = &p->held; *lp && *lp != lk; lp = &(*lp)->nextheld)
+    ;
+  if(*lp)
+    *lp = lk->nextheld;
   lk->locked = 0;
   lk->pid = 0;
+  lk->owner = 0;
+  lk->nextheld = 0;
   wakeup(lk);
   release(&lk->lk);
+
+  // keep only what is lent by the waiters for the locks
+  // p still holds. they are asleep, so their ranks hold still;
+  // one that lent p its rank while we looked makes us look again.
+  while((was = p->inherited) != NOINHERIT){
+    rank = NOINHERIT;
+    for(h = p->held; h; h = h->nextheld){
+      acquire(&h->lk);
+      for(w = h->waiters; w; w = w->lknext){
+        int r = schedrank(w);
+        if(r < rank)
+          rank = r;
+      }
+      release(&h->lk);
+    }
+    acquire(&p->lock);
+    if(p->inherited == was){
+      setinherited(p, rank);
+      release(&p->lock);
+      break;
+    }
+    release(&p->lock);
+  }
 }
 
 int
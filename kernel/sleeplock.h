@@ -2,7 +2,12 @@
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
-  
+
+  // For priority inheritance:
+  struct proc *owner;         // Process holding lock
+  struct proc *waiters;       // Processes waiting for it, linked by lknext
+  struct sleeplock *nextheld; // Next lock the owner holds
+
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
@@ -0,0 +1,14 @@
+// File actions for spawn(). They are done in order, to the
+// child's copy of its parent's open files, before it runs.
+#define SPAWN_CLOSE 1   // close fd
+#define SPAWN_OPEN  2   // open path with flags arg as fd
+#define SPAWN_DUP   3   // make fd another reference to open fd arg
+
+#define NSPAWNACT 8     // most file actions per spawn()
+
+struct spawnact {
+  int op;
+  int fd;
+  int arg;
+  char *path;
+};
@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "syscall.h"
 #include "defs.h"
@@ -107,6 +108,20 @@ extern uint64 sys_set_priority(void);
 extern uint64 sys_sigalarm(void);
 extern uint64 sys_sigreturn(void);
 extern uint64 sys_waitx(void);
+extern uint64 sys_setscheduler(void);
+extern uint64 sys_sched_setdeadline(void);
+extern uint64 sys_getrusage(void);
+extern uint64 sys_sysctl(void);
+extern uint64 sys_sched_setaffinity(void);
+extern uint64 sys_sched_getaffinity(void);
+extern uint64 sys_cpustats(void);
+extern uint64 sys_schedtrace(void);
+extern uint64 sys_setcpuquota(void);
+extern uint64 sys_setcpugroup(void);
+extern uint64 sys_sched_yield(void);
+extern uint64 sys_yield_to(void);
+extern uint64 sys_kmemstats(void);
+extern uint64 sys_spawn(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
@@ -137,12 +152,26 @@ static uint64 (*syscalls[])(void) = {
 [SYS_set_priority] sys_set_priority,
 [SYS_sigalarm] sys_sigalarm,
 [SYS_sigreturn] sys_sigreturn,
-[SYS_waitx]   sys_waitx
+[SYS_waitx]   sys_waitx,
+[SYS_setscheduler] sys_setscheduler,
+[SYS_sched_setdeadline] sys_sched_setdeadline,
+[SYS_getrusage] sys_getrusage,
+[SYS_sysctl]  sys_sysctl,
+[SYS_sched_setaffinity] sys_sched_setaffinity,
+[SYS_sched_getaffinity] sys_sched_getaffinity,
+[SYS_cpustats] sys_cpustats,
+[SYS_schedtrace] sys_schedtrace,
+[SYS_setcpuquota] sys_setcpuquota,
+[SYS_setcpugroup] sys_setcpugroup,
+[SYS_sched_yield] sys_sched_yield,
+[SYS_yield_to] sys_yield_to,
+[SYS_kmemstats] sys_kmemstats,
+[SYS_spawn] sys_spawn,
 };
 
 // LUT for system call names.
-static char *syscallnames[] = {"fork", "exit", "wait", "pipe", "read", "kill", "exec", "fstat", "chdir", "dup", "getpid", "sbrk", "sleep", "uptime", "open", "write", "mknod", "unlink", "link", "mkdir", "close", "trace", "settickets", "setpriority", "sigalarm", "sigreturn", "waitx"};
-static int totalArgs[] = {0, 1, 1, 0, 3, 2, 2, 1, 1, 1, 0, 1, 1, 0, 2, 3, 3, 1, 2, 1, 1, 1, 1, 2, 2, 0, 3};
+static char *syscallnames[] = {"fork", "exit", "wait", "pipe", "read", "kill", "exec", "fstat", "chdir", "dup", "getpid", "sbrk", "sleep", "uptime", "open", "write", "mknod", "unlink", "link", "mkdir", "close", "trace", "settickets", "setpriority", "sigalarm", "sigreturn", "waitx", "setscheduler", "sched_setdeadline", "getrusage", "sysctl", "sched_setaffinity", "sched_getaffinity", "cpustats", "schedtrace", "setcpuquota", "setcpugroup", "sched_yield", "yield_to", "kmemstats", "spawn"};
+static int totalArgs[] = {0, 1, 1, 0, 3, 2, 2, 1, 1, 1, 0, 1, 1, 0, 2, 3, 3, 1, 2, 1, 1, 1, 1, 2, 2, 0, 4, 1, 3, 2, 3, 2, 1, 1, 2, 3, 2, 0, 1, 1, 4};
 
 void
 syscall(void)
@@ -150,7 +179,7 @@ syscall(void)
   int num;
   struct proc *p = myproc();
 
-  int args[3];
+  int args[6];
 
   num = p->trapframe->a7;
 
@@ -164,7 +193,7 @@ syscall(void)
     // get argument number
     
     p->trapframe->a0 = syscalls[num]();
-    if ((1 << num) & p->trace) 
+    if ((1L << num) & p->trace) 
     {
       printf("%d: syscall %s (", p->pid, syscallnames[num - 1]);
       for (int i = 0; i < totalArgs[num - 1]; i++)
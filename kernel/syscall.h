@@ -25,4 +25,18 @@
 #define SYS_set_priority 24
 #define SYS_sigalarm 25
 #define SYS_sigreturn 26
-#define SYS_waitx 27
\ No newline at end of file
+#define SYS_waitx 27
+#define SYS_setscheduler 28
+#define SYS_sched_setdeadline 29
+#define SYS_getrusage 30
+#define SYS_sysctl 31
+#define SYS_sched_setaffinity 32
+#define SYS_sched_getaffinity 33
+#define SYS_cpustats 34
+#define SYS_schedtrace 35
+#define SYS_setcpuquota 36
+#define SYS_setcpugroup 37
+#define SYS_sched_yield 38
+#define SYS_yield_to 39
+#define SYS_kmemstats 40
+#define SYS_spawn 41
\ No newline at end of file
@@ -0,0 +1,69 @@
+// Kernel parameters that can be read and changed at run
+// time with the sysctl() system call, so that they can be
+// tuned without rebuilding the kernel. Each one is an int
+// kept by the code that uses it; ctls[] has its bounds.
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
+#include "sysctl.h"
+#include "defs.h"
+
+struct ctl {
+  int *val;
+  int min, max;
+};
+
+static struct ctl ctls[NCTL] = {
+  [CTL_MLFQ_LEVELS]     { &mlfq_levels, 1, NQUEUE },
+  [CTL_MLFQ_BOOST]      { &mlfq_boost, 0, 100000 },
+  [CTL_MLFQ_SLICE + 0]  { &mlfq_slice[0], 1, 1000 },
+  [CTL_MLFQ_SLICE + 1]  { &mlfq_slice[1], 1, 1000 },
+  [CTL_MLFQ_SLICE + 2]  { &mlfq_slice[2], 1, 1000 },
+  [CTL_MLFQ_SLICE + 3]  { &mlfq_slice[3], 1, 1000 },
+  [CTL_MLFQ_SLICE + 4]  { &mlfq_slice[4], 1, 1000 },
+  // level 0 has nowhere to be promoted to.
+  [CTL_MLFQ_AGE + 0]    { &mlfq_agelimit[0], 0, 0 },
+  [CTL_MLFQ_AGE + 1]    { &mlfq_agelimit[1], 1, 100000 },
+  [CTL_MLFQ_AGE + 2]    { &mlfq_agelimit[2], 1, 100000 },
+  [CTL_MLFQ_AGE + 3]    { &mlfq_agelimit[3], 1, 100000 },
+  [CTL_MLFQ_AGE + 4]    { &mlfq_agelimit[4], 1, 100000 },
+  [CTL_SCHED_TRACE]     { &schedtrace_on, 0, 1 },
+  [CTL_SCHED_INHERIT]   { &sched_inherit, 0, 1 },
+};
+
+// serializes writers; readers just load the int.
+static struct spinlock ctl_lock;
+
+void
+sysctlinit(void)
+{
+  initlock(&ctl_lock, "sysctl");
+}
+
+// Store parameter id's value in *old, if old is not 0, and
+// then set it to *new, if new is not 0.
+// Returns -1 if there is no such parameter or *new is out
+// of its bounds.
+int
+sysctl(int id, int *old, int *new)
+{
+  struct ctl *c;
+
+  if(id < 0 || id >= NCTL)
+    return -1;
+  c = &ctls[id];
+  if(new && (*new < c->min || *new > c->max))
+    return -1;
+
+  acquire(&ctl_lock);
+  if(old)
+    *old = *c->val;
+  if(new)
+    *c->val = *new;
+  release(&ctl_lock);
+  return 0;
+}
@@ -0,0 +1,8 @@
+// Kernel parameters, for sysctl().
+#define CTL_MLFQ_LEVELS   0  // MLFQ levels in use, 1..5
+#define CTL_MLFQ_BOOST    1  // ticks between boosts of everything to the top level, 0 for none
+#define CTL_MLFQ_SLICE    2  // + level 0..4: time slice in ticks at that level
+#define CTL_MLFQ_AGE      7  // + level 1..4: ticks waited at that level before promotion
+#define CTL_SCHED_TRACE  12  // record scheduler events for schedtrace(), 0 or 1
+#define CTL_SCHED_INHERIT 13 // priority inheritance on sleeplocks, 0 or 1
+#define NCTL             14
@@ -10,11 +10,13 @@
 #include "param.h"
 #include "stat.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "spawn.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -301,18 +303,13 @@ create(char *path, short type, short major, short minor)
   return 0;
 }
 
-uint64
-sys_open(void)
+// Open path as open() would, but without giving it a
+// file descriptor. Returns 0 on failure.
+static struct file*
+openfile(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  argint(1, &omode);
-  if((n = argstr(0, path, MAXPATH)) < 0)
-    return -1;
 
   begin_op();
 
@@ -320,33 +317,31 @@ sys_open(void)
     ip = create(path, T_FILE, 0, 0);
     if(ip == 0){
       end_op();
-      return -1;
+      return 0;
     }
   } else {
     if((ip = namei(path)) == 0){
       end_op();
-      return -1;
+      return 0;
     }
     ilock(ip);
     if(ip->type == T_DIR && omode != O_RDONLY){
       iunlockput(ip);
       end_op();
-      return -1;
+      return 0;
     }
   }
 
   if(ip->type == T_DEVICE && (ip->major < 0 || ip->major >= NDEV)){
     iunlockput(ip);
     end_op();
-    return -1;
+    return 0;
   }
 
-  if((f = filealloc()) == 0 || (fd = fdalloc(f)) < 0){
-    if(f)
-      fileclose(f);
+  if((f = filealloc()) == 0){
     iunlockput(ip);
     end_op();
-    return -1;
+    return 0;
   }
 
   if(ip->type == T_DEVICE){
@@ -367,6 +362,26 @@ sys_open(void)
   iunlock(ip);
   end_op();
 
+  return f;
+}
+
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int fd, omode;
+  struct file *f;
+
+  argint(1, &omode);
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
+
+  if((f = openfile(path, omode)) == 0)
+    return -1;
+  if((fd = fdalloc(f)) < 0){
+    fileclose(f);
+    return -1;
+  }
   return fd;
 }
 
@@ -431,47 +446,121 @@ sys_chdir(void)
   return 0;
 }
 
-uint64
-sys_exec(void)
+// Fetch the null-terminated array of user strings at uargv
+// into argv, a kalloc()ed page per string. Whatever was
+// fetched must be given back with freeargv(), even on failure.
+static int
+fetchargv(uint64 uargv, char **argv)
 {
-  char path[MAXPATH], *argv[MAXARG];
   int i;
-  uint64 uargv, uarg;
+  uint64 uarg;
 
-  argaddr(1, &uargv);
-  if(argstr(0, path, MAXPATH) < 0) {
-    return -1;
-  }
-  memset(argv, 0, sizeof(argv));
+  memset(argv, 0, MAXARG * sizeof(argv[0]));
   for(i=0;; i++){
-    if(i >= NELEM(argv)){
-      goto bad;
+    if(i >= MAXARG){
+      return -1;
     }
     if(fetchaddr(uargv+sizeof(uint64)*i, (uint64*)&uarg) < 0){
-      goto bad;
+      return -1;
     }
     if(uarg == 0){
       argv[i] = 0;
-      break;
+      return 0;
     }
     argv[i] = kalloc();
     if(argv[i] == 0)
-      goto bad;
+      return -1;
     if(fetchstr(uarg, argv[i], PGSIZE) < 0)
-      goto bad;
+      return -1;
   }
+}
 
-  int ret = exec(path, argv);
-
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
+static void
+freeargv(char **argv)
+{
+  for(int i = 0; i < MAXARG && argv[i] != 0; i++)
     kfree(argv[i]);
+}
 
+uint64
+sys_exec(void)
+{
+  char path[MAXPATH], *argv[MAXARG];
+  uint64 uargv;
+  int ret = -1;
+
+  argaddr(1, &uargv);
+  if(argstr(0, path, MAXPATH) < 0) {
+    return -1;
+  }
+  if(fetchargv(uargv, argv) == 0)
+    ret = exec(path, argv);
+  freeargv(argv);
   return ret;
+}
 
- bad:
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
-    kfree(argv[i]);
-  return -1;
+uint64
+sys_spawn(void)
+{
+  char path[MAXPATH], apath[MAXPATH], *argv[MAXARG];
+  struct spawnact act[NSPAWNACT];
+  struct file *ofile[NOFILE], *f;
+  struct proc *p = myproc();
+  uint64 uargv, uact;
+  int i, fd, arg, nact, pid = -1;
+
+  argaddr(1, &uargv);
+  argaddr(2, &uact);
+  argint(3, &nact);
+  if(argstr(0, path, MAXPATH) < 0 || nact < 0 || nact > NSPAWNACT)
+    return -1;
+  if(copyin(p->pagetable, (char*)act, uact, nact * sizeof(act[0])) < 0)
+    return -1;
+  if(fetchargv(uargv, argv) < 0){
+    freeargv(argv);
+    return -1;
+  }
+
+  // the child's open files: the caller's, then the actions.
+  for(i = 0; i < NOFILE; i++)
+    ofile[i] = p->ofile[i] ? filedup(p->ofile[i]) : 0;
+  for(i = 0; i < nact; i++){
+    fd = act[i].fd;
+    arg = act[i].arg;
+    if(fd < 0 || fd >= NOFILE)
+      goto out;
+    f = 0;
+    switch(act[i].op){
+    case SPAWN_CLOSE:
+      break;
+    case SPAWN_OPEN:
+      if(fetchstr((uint64)act[i].path, apath, MAXPATH) < 0 ||
+         (f = openfile(apath, arg)) == 0)
+        goto out;
+      break;
+    case SPAWN_DUP:
+      if(arg < 0 || arg >= NOFILE || ofile[arg] == 0)
+        goto out;
+      f = filedup(ofile[arg]);
+      break;
+    default:
+      goto out;
+    }
+    if(ofile[fd])
+      fileclose(ofile[fd]);
+    ofile[fd] = f;
+  }
+
+  pid = spawn(path, argv, ofile);
+
+ out:
+  if(pid < 0){
+    for(i = 0; i < NOFILE; i++)
+      if(ofile[i])
+        fileclose(ofile[i]);
+  }
+  freeargv(argv);
+  return pid;
 }
 
 uint64
@@ -4,7 +4,11 @@
 #include "param.h"
 #include "memlayout.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
+#include "rusage.h"
+#include "cpustat.h"
+#include "kmemstat.h"
 
 uint64
 sys_exit(void)
@@ -93,8 +97,8 @@ sys_uptime(void)
 uint64
 sys_trace(void)
 {
-  int mask;
-  argint(0, &mask);
+  uint64 mask;
+  argaddr(0, &mask);
   if(mask < 2)
   {
     return -1;
@@ -113,6 +117,8 @@ sys_settickets(void)
     return -1;
   }
 
+  // the caller is running, so it is not on a run queue; the
+  // lottery tree picks up the new count when it is queued again.
   acquire(&myproc()->lock);
 
   // printf("Tickets before: %d\n", myproc()->tickets);
@@ -203,16 +209,192 @@ sys_sigreturn(void)
 uint64
 sys_waitx(void)
 {
-  uint64 addr, addr1, addr2;
+  uint64 addr, addr1, addr2, addr3;
   uint wtime, rtime;
+  struct rusage ru;
   argaddr(0, &addr);
   argaddr(1, &addr1); // user virtual memory
   argaddr(2, &addr2);
-  int ret = waitx(addr, &wtime, &rtime);
+  argaddr(3, &addr3); // optional
+  int ret = waitx(addr, &wtime, &rtime, &ru);
   struct proc* p = myproc();
   if (copyout(p->pagetable, addr1,(char*)&wtime, sizeof(int)) < 0)
     return -1;
   if (copyout(p->pagetable, addr2,(char*)&rtime, sizeof(int)) < 0)
     return -1;
+  if (ret >= 0 && addr3 != 0 && copyout(p->pagetable, addr3, (char*)&ru, sizeof(ru)) < 0)
+    return -1;
   return ret;
-}
\ No newline at end of file
+}
+uint64
+sys_setscheduler(void)
+{
+  int policy;
+  argint(0, &policy);
+  return setscheduler(policy);
+}
+
+uint64
+sys_sched_setdeadline(void)
+{
+  int runtime, period, deadline;
+  argint(0, &runtime);
+  argint(1, &period);
+  argint(2, &deadline);
+  if(setdeadline(myproc(), runtime, period, deadline) < 0)
+    return -1;
+  // requeue, on the cpu the reservation was made on.
+  yield();
+  return 0;
+}
+
+uint64
+sys_getrusage(void)
+{
+  int pid;
+  uint64 addr;
+  struct rusage ru;
+  argint(0, &pid);
+  argaddr(1, &addr);
+  if(getrusage(pid, &ru) < 0)
+    return -1;
+  if(copyout(myproc()->pagetable, addr, (char*)&ru, sizeof(ru)) < 0)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_sysctl(void)
+{
+  int id, old, new;
+  uint64 oldaddr, newaddr;
+  struct proc *p = myproc();
+  argint(0, &id);
+  argaddr(1, &oldaddr);
+  argaddr(2, &newaddr);
+  if(newaddr && copyin(p->pagetable, (char*)&new, newaddr, sizeof(new)) < 0)
+    return -1;
+  if(sysctl(id, &old, newaddr ? &new : 0) < 0)
+    return -1;
+  if(oldaddr && copyout(p->pagetable, oldaddr, (char*)&old, sizeof(old)) < 0)
+    return -1;
+  return 0;
+}
+
+uint64
+sys_sched_setaffinity(void)
+{
+  int pid, mask, ret;
+  struct proc *p;
+  argint(0, &pid);
+  argint(1, &mask);
+  if(pid == 0){
+    p = myproc();
+    acquire(&p->lock);
+  } else if((p = getProc(pid)) == 0){
+    return -1;
+  }
+  ret = setaffinity(p, (uint)mask);
+  release(&p->lock);
+  // move off this cpu now if it is no longer allowed.
+  if(ret == 0 && p == myproc())
+    yield();
+  return ret;
+}
+
+uint64
+sys_sched_getaffinity(void)
+{
+  int pid;
+  uint64 mask;
+  struct proc *p;
+  argint(0, &pid);
+  if(pid == 0){
+    p = myproc();
+    acquire(&p->lock);
+  } else if((p = getProc(pid)) == 0){
+    return -1;
+  }
+  mask = getaffinity(p);
+  release(&p->lock);
+  return mask;
+}
+
+uint64
+sys_cpustats(void)
+{
+  uint64 addr;
+  struct cpustat st[NCPU];
+  argaddr(0, &addr);
+  cpustats(st);
+  if(copyout(myproc()->pagetable, addr, (char*)st, sizeof(st)) < 0)
+    return -1;
+  return NCPU;
+}
+
+uint64
+sys_schedtrace(void)
+{
+  uint64 addr;
+  int n;
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0)
+    return -1;
+  return schedtrace(addr, n);
+}
+
+uint64
+sys_setcpuquota(void)
+{
+  int gid, quota, period;
+  argint(0, &gid);
+  argint(1, &quota);
+  argint(2, &period);
+  return setcpuquota(gid, quota, period);
+}
+
+uint64
+sys_setcpugroup(void)
+{
+  int pid, gid, old;
+  struct proc *p;
+  argint(0, &pid);
+  argint(1, &gid);
+  if(pid == 0){
+    p = myproc();
+    acquire(&p->lock);
+  } else if((p = getProc(pid)) == 0){
+    return -1;
+  }
+  old = setcpugroup(p, gid);
+  release(&p->lock);
+  return old;
+}
+
+uint64
+sys_sched_yield(void)
+{
+  sched_yield();
+  return 0;
+}
+
+uint64
+sys_yield_to(void)
+{
+  int pid;
+  argint(0, &pid);
+  return yieldto(pid);
+}
+
+uint64
+sys_kmemstats(void)
+{
+  uint64 addr;
+  struct kmemstat st;
+  argaddr(0, &addr);
+  kmemstats(&st);
+  if(copyout(myproc()->pagetable, addr, (char*)&st, sizeof(st)) < 0)
+    return -1;
+  return 0;
+}
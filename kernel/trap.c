@@ -3,6 +3,7 @@
 #include "memlayout.h"
 #include "riscv.h"
 #include "spinlock.h"
+#include "rbtree.h"
 #include "proc.h"
 #include "defs.h"
 
@@ -16,6 +17,9 @@ void kernelvec();
 
 extern int devintr();
 
+// in start.c; see timervec in kernelvec.S.
+extern uint64 timer_scratch[NCPU][7];
+
 void
 trapinit(void)
 {
@@ -69,56 +73,13 @@ usertrap(void)
     syscall();
   } 
   else if (r_scause() == 15) {
-    int va = r_stval();
-    if (va >= MAXVA)
-    {
-      setkilled(p);
-      exit(-1);
-    }
-    if (va == 0)
-    {
-      setkilled(p);
-      exit(-1);
-    }
-
-    pte_t* pte = walk(p->pagetable, va, 0);
-    if (pte == 0)
-    {
-      setkilled(p);
-      exit(-1);
-    } 
-
-
-    if (!(*pte & PTE_W) && !(*pte & PTE_COW))
-    {
-      setkilled(p);
-      exit(-1);
-    }
-
-
-    // check for user and valid
-    if ((*pte & PTE_W) || !(*pte & PTE_U) || !(*pte & PTE_V))
+    // store page fault: only a copy-on-write page should
+    // take one, and the process is killed for anything else.
+    if (cowfault(p->pagetable, r_stval()) < 0)
     {
       setkilled(p);
       exit(-1);
     }
-
-    uint64 new = (uint64)kalloc();
-
-    if (new == 0)
-    {
-      setkilled(p);
-      exit(-1);
-    }
-
-    memmove((char *)new, (char *)PTE2PA(*pte), PGSIZE);
-    // since this is the faulting process, we could assign it the new page, since we do not know which other child has it
-
-    uint64 old = PTE2PA(*pte);
-    *pte = PA2PTE(new) | PTE_V | PTE_R | PTE_W | PTE_U | PTE_X;
-    *pte &= ~PTE_COW;
-
-    kfree((char *)old);
   }
   else if((which_dev = devintr()) != 0){
     // ok
@@ -151,9 +112,8 @@ usertrap(void)
     }
     release(&p->lock);
 
-    #if !defined(FCFS) && !defined(PBS)
-    yield();
-    #endif
+    if(schedtick())
+      yield();
   }
   
   usertrapret();
@@ -248,9 +208,8 @@ kerneltrap()
     // }
     // release(&p->lock);
 
-    #if !defined(FCFS) && !defined(PBS)
-    yield();
-    #endif
+    if(schedtick())
+      yield();
   }
 
   // printf("no: %d\n", which_dev);
@@ -265,10 +224,19 @@ clockintr()
 {
   acquire(&tickslock);
   ticks++;
-  update_time();
   // printf("\nCurrent Tick: %d\n", ticks);
   wakeup(&ticks);
   release(&tickslock);
+  cpugrouptick();
+}
+
+// Send hart id an IPI, to get it out of wfi.
+// It arrives there as a machine software interrupt,
+// which timervec forwards like a timer interrupt.
+void
+ipi(int id)
+{
+  *(uint32*)CLINT_MSIP(id) = 1;
 }
 
 // check if it's an external interrupt or software interrupt,
@@ -304,16 +272,22 @@ devintr()
 
     return 1;
   } else if(scause == 0x8000000000000001L){
-    // software interrupt from a machine-mode timer interrupt,
-    // forwarded by timervec in kernelvec.S.
+    // software interrupt from a machine-mode timer interrupt
+    // or IPI, forwarded by timervec in kernelvec.S.
+
+    // acknowledge the software interrupt by clearing
+    // the SSIP bit in sip. do it before looking at the tick
+    // flag, so that a tick that comes in between is not lost.
+    w_sip(r_sip() & ~2);
+
+    if(__sync_lock_test_and_set(&timer_scratch[cpuid()][6], 0) == 0){
+      // an IPI, just to get this hart out of wfi; see idle().
+      return 1;
+    }
 
     if(cpuid() == 0){
       clockintr();
     }
-    
-    // acknowledge the software interrupt by clearing
-    // the SSIP bit in sip.
-    w_sip(r_sip() & ~2);
 
     return 2;
   } else {
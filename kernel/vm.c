@@ -5,6 +5,9 @@
 #include "riscv.h"
 #include "defs.h"
 #include "fs.h"
+#include "spinlock.h"
+#include "rbtree.h"
+#include "proc.h"
 
 /*
  * the kernel's page table.
@@ -15,6 +18,11 @@ extern char etext[];  // kernel.ld sets this to end of kernel code.
 
 extern char trampoline[]; // trampoline.S
 
+// bytes of address space mapped by one leaf page-table page.
+#define PTSPAN (512 * (uint64)PGSIZE)
+
+static int unshare(pte_t *pde);
+
 // Make a direct-map page table for the kernel.
 pagetable_t
 kvmmake(void)
@@ -33,6 +41,9 @@ kvmmake(void)
   // PLIC
   kvmmap(kpgtbl, PLIC, PLIC, 0x400000, PTE_R | PTE_W);
 
+  // CLINT, for sending IPIs and turning off idle harts' timers
+  kvmmap(kpgtbl, CLINT, CLINT, 0x10000, PTE_R | PTE_W);
+
   // map kernel text executable and read-only.
   kvmmap(kpgtbl, KERNBASE, KERNBASE, (uint64)etext-KERNBASE, PTE_R | PTE_X);
 
@@ -72,7 +83,9 @@ kvminithart()
 
 // Return the address of the PTE in page table pagetable
 // that corresponds to virtual address va.  If alloc!=0,
-// create any required page-table pages.
+// create any required page-table pages, and make sure the
+// leaf page-table page is this page table's alone, so that
+// the PTE can be changed; see uvmcopy().
 //
 // The risc-v Sv39 scheme has three levels of page-table
 // pages. A page-table page contains 512 64-bit PTEs.
@@ -91,6 +104,8 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
   for(int level = 2; level > 0; level--) {
     pte_t *pte = &pagetable[PX(level, va)];
     if(*pte & PTE_V) {
+      if(level == 1 && alloc && unshare(pte) < 0)
+        return 0;
       pagetable = (pagetable_t)PTE2PA(*pte);
     } else {
       if(!alloc || (pagetable = (pde_t*)kalloc()) == 0)
@@ -102,6 +117,79 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
   return &pagetable[PX(0, va)];
 }
 
+// Return the address of the level-1 PTE in pagetable that
+// points at the leaf page-table page for va. If alloc!=0,
+// create the level-1 page-table page if it is missing.
+static pte_t *
+walkpde(pagetable_t pagetable, uint64 va, int alloc)
+{
+  pte_t *pte = &pagetable[PX(2, va)];
+
+  if(*pte & PTE_V) {
+    pagetable = (pagetable_t)PTE2PA(*pte);
+  } else {
+    if(!alloc || (pagetable = (pde_t*)kalloc()) == 0)
+      return 0;
+    memset(pagetable, 0, PGSIZE);
+    *pte = PA2PTE(pagetable) | PTE_V;
+  }
+  return &pagetable[PX(1, va)];
+}
+
+// Drop a reference to the leaf page-table page pt. If it
+// was the last one, free pt and the pages it maps.
+static void
+freeleaf(pagetable_t pt)
+{
+  if(decRef((uint64)pt) > 0)
+    return;
+  for(int i = 0; i < 512; i++)
+    if(pt[i] & PTE_V)
+      kfree((void*)PTE2PA(pt[i]));
+  kfreepage(pt);
+}
+
+// Leaf page-table pages can be shared by a process and the
+// children it forks; see uvmcopy(). Give the page table that
+// the level-1 PTE *pde is in a copy of its own of the leaf
+// page-table page *pde points at, if others share it.
+// Returns -1 if there is no memory for the copy.
+static int
+unshare(pte_t *pde)
+{
+  pagetable_t old = (pagetable_t)PTE2PA(*pde), new;
+
+  if(getRef((uint64)old) == 1)
+    return 0;
+  if((new = (pagetable_t)kalloc()) == 0)
+    return -1;
+  for(int i = 0; i < 512; i++){
+    new[i] = old[i];
+    if(old[i] & PTE_V)
+      incRef(PTE2PA(old[i]));
+  }
+  *pde = PA2PTE(new) | PTE_V;
+  // the others may have let go of old since we looked.
+  freeleaf(old);
+  return 0;
+}
+
+// Drop pagetable's references to the leaf page-table pages
+// for [0, sz), freeing those no one else is using, along
+// with the pages they map.
+static void
+freeleaves(pagetable_t pagetable, uint64 sz)
+{
+  pte_t *pde;
+
+  for(uint64 a = 0; a < sz; a += PTSPAN){
+    if((pde = walkpde(pagetable, a, 0)) == 0 || (*pde & PTE_V) == 0)
+      continue;
+    freeleaf((pagetable_t)PTE2PA(*pde));
+    *pde = 0;
+  }
+}
+
 // Look up a virtual address, return the physical address,
 // or 0 if not mapped.
 // Can only be used to look up user pages.
@@ -177,6 +265,13 @@ uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
     panic("uvmunmap: not aligned");
 
   for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
+    // don't take the page away from others sharing the
+    // leaf page-table page.
+    if(a == va || PX(0, a) == 0){
+      pte_t *pde = walkpde(pagetable, a, 0);
+      if(pde && (*pde & PTE_V) && unshare(pde) < 0)
+        panic("uvmunmap: unshare");
+    }
     if((pte = walk(pagetable, a, 0)) == 0)
       panic("uvmunmap: walk");
     if((*pte & PTE_V) == 0)
@@ -251,13 +346,24 @@ uvmalloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz, int xperm)
 // Deallocate user pages to bring the process size from oldsz to
 // newsz.  oldsz and newsz need not be page-aligned, nor does newsz
 // need to be less than oldsz.  oldsz can be larger than the actual
-// process size.  Returns the new process size.
+// process size.  Returns the new process size, which is oldsz if
+// there was no memory to do it.
 uint64
 uvmdealloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz)
 {
   if(newsz >= oldsz)
     return oldsz;
 
+  // uvmunmap() can't fail, so copy any shared leaf
+  // page-table pages it will change first, while a
+  // shortage of memory can still be reported.
+  for(uint64 a = PGROUNDUP(newsz); a < PGROUNDUP(oldsz);
+      a = (a + PTSPAN) & ~(PTSPAN - 1)){
+    pte_t *pde = walkpde(pagetable, a, 0);
+    if(pde && (*pde & PTE_V) && unshare(pde) < 0)
+      return oldsz;
+  }
+
   if(PGROUNDUP(newsz) < PGROUNDUP(oldsz)){
     int npages = (PGROUNDUP(oldsz) - PGROUNDUP(newsz)) / PGSIZE;
     uvmunmap(pagetable, PGROUNDUP(newsz), npages, 1);
@@ -292,119 +398,156 @@ void
 uvmfree(pagetable_t pagetable, uint64 sz)
 {
   if(sz > 0)
-    uvmunmap(pagetable, 0, PGROUNDUP(sz)/PGSIZE, 1);
+    freeleaves(pagetable, PGROUNDUP(sz));
   freewalk(pagetable);
 }
 
-// Given a parent process's page table, copy
-// its memory into a child's page table.
-// Copies both the page table and the
-// physical memory.
+// Given a parent process's page table, share
+// its memory with a child's page table.
+// The child's level-1 PTEs point at the parent's leaf
+// page-table pages, and every page those map is made
+// read-only and copy-on-write, so a fork costs a PTE
+// per leaf page-table page rather than one per page.
+// A leaf page-table page that is already shared, with
+// an earlier child, maps nothing writable, and isn't
+// looked through again.
 // returns 0 on success, -1 on failure.
 // frees any allocated pages on failure.
 int
 uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
 {
-  pte_t *pte;
-  uint64 pa, i;
-  uint flags;
-  // char *mem;
+  pte_t *pde, *npde;
+  pagetable_t pt;
+  uint64 a;
 
-  for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walk(old, i, 0)) == 0)
+  for(a = 0; a < sz; a += PTSPAN){
+    if((pde = walkpde(old, a, 0)) == 0 || (*pde & PTE_V) == 0)
       panic("uvmcopy: pte should exist");
-    if((*pte & PTE_V) == 0)
-      panic("uvmcopy: page not present");
-    pa = PTE2PA(*pte);
-    // remove write perms of page in parent
-    *pte &= ~PTE_W;
-    *pte |= PTE_COW;
-    flags = PTE_FLAGS(*pte);
-    
-    // memmove(mem, (char*)pa, PGSIZE);
-    if(mappages(new, i, PGSIZE, (uint64)pa, flags) != 0){
-      // kfree(mem);
+    if((npde = walkpde(new, a, 1)) == 0)
       goto err;
+    pt = (pagetable_t)PTE2PA(*pde);
+    // no one else can see pt while only we have it.
+    if(getRef((uint64)pt) == 1){
+      for(int i = 0; i < 512; i++){
+        if(pt[i] & PTE_V){
+          // remove write perms of page in parent
+          pt[i] &= ~PTE_W;
+          pt[i] |= PTE_COW;
+        }
+      }
     }
-    incRef(pa);
+    incRef((uint64)pt);
+    *npde = *pde;
   }
   return 0;
 
  err:
-  uvmunmap(new, 0, i / PGSIZE, 1);
+  freeleaves(new, a);
   return -1;
 }
 
-// mark a PTE invalid for user access.
-// used by exec for the user stack guard page.
-void
-uvmclear(pagetable_t pagetable, uint64 va)
+// Make the copy-on-write page at va writable for the process
+// whose page table this is, which must be the caller's. If no
+// other page table maps the page any more (the others have
+// exited or exec'd), it is simply taken over; otherwise the
+// process gets a copy of its own.
+// Returns -1 if va is not a copy-on-write user page, or
+// if there is no memory for the copy.
+int
+cowfault(pagetable_t pagetable, uint64 va)
 {
   pte_t *pte;
-  
-  pte = walk(pagetable, va, 0);
-  if(pte == 0)
-    panic("uvmclear");
-  *pte &= ~PTE_U;
-}
+  uint64 pa, mem;
 
-// Copy from kernel to user.
-// Copy len bytes from src to virtual address dstva in a given page table.
-// Return 0 on success, -1 on error.
-int
-copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
-{
-  uint64 n, va0, pa0;
-  va0 = PGROUNDDOWN(dstva);
-  // check for page fault
-  if (va0 >= MAXVA)
+  if (va >= MAXVA || PGROUNDDOWN(va) == 0)
   {
     return -1;
   }
-
-  if (va0 == 0)
+  pte = walk(pagetable, va, 0);
+  if (pte == 0 || !(*pte & PTE_V) || !(*pte & PTE_U) ||
+      (*pte & PTE_W) || !(*pte & PTE_COW))
   {
     return -1;
   }
-
-  pte_t* pte = walk(pagetable, va0, 0);
-  if (pte == 0)
+  // the PTE is about to change; get a leaf page-table
+  // page of our own first if it's shared.
+  if ((pte = walk(pagetable, va, 1)) == 0)
   {
     return -1;
   }
 
-  if (!(*pte & PTE_W) && !(*pte & PTE_COW))
+  pa = PTE2PA(*pte);
+  // only a fork of this process could add a reference, and
+  // it can't be forking while it is here.
+  if (getRef(pa) == 1)
   {
-    return -1;
+    *pte = (*pte | PTE_W) & ~PTE_COW;
+    myproc()->cowreused++;
+    return 0;
   }
 
-  // check for user and valid
-  if (!(*pte & PTE_U) || !(*pte & PTE_V))
+  if ((mem = (uint64)kalloc()) == 0)
   {
     return -1;
   }
+  memmove((char *)mem, (char *)pa, PGSIZE);
+  *pte = PA2PTE(mem) | PTE_V | PTE_R | PTE_W | PTE_U | PTE_X;
+  kfree((char *)pa);
+  myproc()->cowcopied++;
+  return 0;
+}
 
-  uint64 new = (uint64)kalloc();
+// mark a PTE invalid for user access.
+// used by exec for the user stack guard page.
+void
+uvmclear(pagetable_t pagetable, uint64 va)
+{
+  pte_t *pte;
+  
+  pte = walk(pagetable, va, 0);
+  if(pte == 0)
+    panic("uvmclear");
+  *pte &= ~PTE_U;
+}
+
+// Copy from kernel to user.
+// Copy len bytes from src to virtual address dstva in a given page table.
+// Return 0 on success, -1 on error.
+int
+copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
+{
+  uint64 n, va0, pa0;
+  pte_t *pte;
 
-  if (new == 0)
+  if (PGROUNDDOWN(dstva) == 0)
   {
     return -1;
   }
 
-  memmove((char *)new, (char *)PTE2PA(*pte), PGSIZE);
-  // since this is the faulting process, we could assign it the new page, since we do not know which other child has it
-
-  uint64 old = PTE2PA(*pte);
-  *pte = PA2PTE(new) | PTE_V | PTE_R | PTE_W | PTE_U | PTE_X;
-  *pte &= ~PTE_COW;
-
-  kfree((char *)old);
-
   while(len > 0){
     va0 = PGROUNDDOWN(dstva);
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0)
+    if (va0 >= MAXVA)
+    {
+      return -1;
+    }
+    pte = walk(pagetable, va0, 0);
+    // check for user and valid
+    if (pte == 0 || !(*pte & PTE_U) || !(*pte & PTE_V))
+    {
       return -1;
+    }
+    // a copy-on-write page has to become this process's own first.
+    // it may move pte to a new leaf page-table page.
+    if ((*pte & PTE_COW) &&
+        (cowfault(pagetable, va0) < 0 || (pte = walk(pagetable, va0, 0)) == 0))
+    {
+      return -1;
+    }
+    if (!(*pte & PTE_W))
+    {
+      return -1;
+    }
+    pa0 = PTE2PA(*pte);
     n = PGSIZE - (dstva - va0);
     if(n > len)
       n = len;
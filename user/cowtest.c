@@ -5,6 +5,7 @@
 #include "kernel/types.h"
 #include "kernel/memlayout.h"
 #include "user/user.h"
+#include "kernel/rusage.h"
 
 // allocate more than half of physical memory,
 // then fork. this will fail in the default
@@ -179,6 +180,88 @@ filetest()
   printf("ok\n");
 }
 
+// once the child has exited, the parent is the only one left
+// with its pages, so writing them should take them back
+// without copying; while the child is still around, writing
+// them has to copy.
+void
+reusetest()
+{
+  int npages = 16;
+  struct rusage before, after;
+  int fds[2];
+  char c;
+
+  printf("reuse: ");
+
+  char *p = sbrk(npages * 4096);
+  if(p == (char*)0xffffffffffffffffL){
+    printf("sbrk failed\n");
+    exit(-1);
+  }
+  for(int i = 0; i < npages; i++)
+    p[i * 4096] = 1;
+
+  int pid = fork();
+  if(pid < 0){
+    printf("fork failed\n");
+    exit(-1);
+  }
+  if(pid == 0)
+    exit(0);
+  wait(0);
+  getrusage(0, &before);
+  for(int i = 0; i < npages; i++)
+    p[i * 4096] = 2;
+  getrusage(0, &after);
+  if(after.ru_cowreused - before.ru_cowreused < npages ||
+     after.ru_cowcopied != before.ru_cowcopied){
+    printf("%d reused, %d copied after the child exited\n",
+           after.ru_cowreused - before.ru_cowreused,
+           after.ru_cowcopied - before.ru_cowcopied);
+    exit(-1);
+  }
+
+  if(pipe(fds) != 0){
+    printf("pipe() failed\n");
+    exit(-1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("fork failed\n");
+    exit(-1);
+  }
+  if(pid == 0){
+    read(fds[0], &c, 1);
+    for(int i = 0; i < npages; i++){
+      if(p[i * 4096] != 2){
+        printf("child saw the parent's write\n");
+        exit(-1);
+      }
+    }
+    exit(0);
+  }
+  getrusage(0, &before);
+  for(int i = 0; i < npages; i++)
+    p[i * 4096] = 3;
+  getrusage(0, &after);
+  write(fds[1], "x", 1);
+  int xstatus;
+  wait(&xstatus);
+  close(fds[0]);
+  close(fds[1]);
+  if(xstatus != 0)
+    exit(-1);
+  if(after.ru_cowcopied - before.ru_cowcopied < npages){
+    printf("%d copied while the child was alive\n",
+           after.ru_cowcopied - before.ru_cowcopied);
+    exit(-1);
+  }
+
+  sbrk(-npages * 4096);
+  printf("ok\n");
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -193,6 +276,8 @@ main(int argc, char *argv[])
 
   filetest();
 
+  reusetest();
+
   printf("ALL COW TESTS PASSED\n");
 
   exit(0);
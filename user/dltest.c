@@ -0,0 +1,147 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// EDF deadline-miss test.
+// usage: dltest [periods]
+//
+// two processes run the same periodic job: every PERIOD ticks
+// they compute for about WORK ticks, which has to be done within
+// DEADLINE ticks. one of them has a reservation made with
+// sched_setdeadline(RUNTIME, PERIOD, DEADLINE), the other is
+// best-effort. both run while heavy floods the machine with
+// CPU-bound processes, and each reports how many deadlines it
+// missed.
+
+#define PERIOD 10
+#define DEADLINE 10
+#define RUNTIME 4
+#define WORK 2
+#define NPERIODS 30
+#define SWEEP 64
+
+int loops_per_tick;
+
+void
+spin(int n)
+{
+  volatile int x = 0;
+
+  for(int i = 0; i < n; i++)
+    x++;
+}
+
+// how many spin() loops fit in a tick on an idle machine.
+int
+calibrate(void)
+{
+  int t, n = 0;
+
+  t = uptime();
+  while(uptime() == t)
+    ;
+  t = uptime();
+  while(uptime() < t + 10){
+    spin(1000);
+    n++;
+  }
+  return n * 1000 / 10;
+}
+
+// run the periodic job and exit with the number of missed deadlines.
+void
+periodic(int reserve, int start, int nperiods)
+{
+  int misses = 0;
+
+  if(reserve && sched_setdeadline(RUNTIME, PERIOD, DEADLINE) < 0){
+    printf("dltest: reservation refused\n");
+    exit(-1);
+  }
+  for(int k = 0; k < nperiods; k++){
+    int release = start + k * PERIOD;
+    int now = uptime();
+    if(now < release)
+      sleep(release - now);
+    spin(WORK * loops_per_tick);
+    if(uptime() > release + DEADLINE)
+      misses++;
+  }
+  exit(misses);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nperiods = NPERIODS;
+  int rt, be, heavy, status;
+  int rtmiss = -1, bemiss = -1;
+
+  if(argc > 1)
+    nperiods = atoi(argv[1]);
+  if(nperiods < 1){
+    printf("usage: dltest [periods]\n");
+    exit(1);
+  }
+
+  loops_per_tick = calibrate();
+
+  // fork the jobs before heavy fills up the process table, and
+  // start them once heavy has had time to get going.
+  int start = uptime() + 50;
+  if((rt = fork()) == 0)
+    periodic(1, start, nperiods);
+  if((be = fork()) == 0)
+    periodic(0, start, nperiods);
+  if(rt < 0 || be < 0){
+    printf("dltest: fork failed\n");
+    exit(1);
+  }
+  if((heavy = fork()) == 0){
+    char *hargv[] = { "heavy", 0 };
+    exec("heavy", hargv);
+    printf("dltest: exec heavy failed\n");
+    exit(1);
+  }
+
+  for(int n = 0; n < 2; ){
+    int pid = wait(&status);
+    if(pid < 0)
+      break;
+    if(pid == rt){
+      rtmiss = status;
+      n++;
+    } else if(pid == be){
+      bemiss = status;
+      n++;
+    }
+  }
+
+  // heavy's processes all have pids above heavy's own, and keep
+  // forking until they are killed; sweep until none are left.
+  if(heavy > 0){
+    int hi = heavy + SWEEP, found = 1;
+    while(found){
+      found = 0;
+      sleep(1);
+      for(int pid = heavy; pid < hi; pid++){
+        if(kill(pid) == 0){
+          found = 1;
+          if(pid + SWEEP > hi)
+            hi = pid + SWEEP;
+        }
+      }
+    }
+  }
+  while(wait(0) >= 0)
+    ;
+
+  printf("%d periods of %d ticks, %d ticks of work due within %d\n",
+         nperiods, PERIOD, WORK, DEADLINE);
+  if(rtmiss < 0)
+    printf("reserved (%d/%d):  refused\n", RUNTIME, PERIOD);
+  else
+    printf("reserved (%d/%d):  %d missed\n", RUNTIME, PERIOD, rtmiss);
+  printf("best-effort:      %d missed\n", bemiss);
+  exit(0);
+}
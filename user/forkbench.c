@@ -0,0 +1,72 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/kmemstat.h"
+
+// Fork latency benchmark.
+// usage: forkbench [ticks]
+//
+// the heap is grown to 1, 2, 4 and on up to 64 MB, writing to
+// every new page so it is really there, and at each size the
+// process forks children that exit straight away, reaping each
+// before the next, for the given number of ticks. the average
+// time a fork and wait took, and the pages the kernel allocated
+// for each, are printed for each size. the children share their
+// parent's leaf page-table pages, so the pages are the child's
+// trapframe and upper-level page-table pages, whatever the size.
+
+#define DURATION 20
+#define MAXMB 64
+#define US_PER_TICK 100000   // qemu's timer interrupt comes every 1/10th second
+
+int
+main(int argc, char *argv[])
+{
+  int duration = DURATION;
+  char *heap = sbrk(0);
+  int have = 0;
+  struct kmemstat before, after;
+
+  if(argc > 1)
+    duration = atoi(argv[1]);
+  if(duration < 1){
+    printf("usage: forkbench [ticks]\n");
+    exit(1);
+  }
+
+  printf("%d ticks per size\n", duration);
+  for(int mb = 1; mb <= MAXMB; mb *= 2){
+    int want = mb * 1024 * 1024, n = 0;
+
+    if(sbrk(want - have) == (char*)-1){
+      printf("forkbench: sbrk %d MB failed\n", mb);
+      exit(1);
+    }
+    for(int i = have; i < want; i += 4096)
+      heap[i] = 1;
+    have = want;
+
+    kmemstats(&before);
+    int end = uptime() + duration;
+    while(uptime() < end){
+      int pid = fork();
+      if(pid < 0){
+        printf("forkbench: fork failed\n");
+        exit(1);
+      }
+      if(pid == 0)
+        exit(0);
+      wait(0);
+      n++;
+    }
+    kmemstats(&after);
+
+    if(n == 0){
+      printf("%d MB: no forks\n", mb);
+      continue;
+    }
+    printf("%d MB: %d forks, %d us each, %d pages each\n", mb, n,
+           duration * US_PER_TICK / n, (int)(after.nalloc - before.nalloc) / n);
+  }
+  exit(0);
+}
@@ -0,0 +1,107 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/kmemstat.h"
+
+// Page allocator benchmark.
+// usage: forkstorm [nworkers] [ticks] [kb]
+//
+// nworkers processes, one per hart by default, each grow a
+// kb-kilobyte heap and then fork and reap children as fast as
+// they can for the given number of ticks. every child writes
+// to every page of the heap, so each fork allocates page-table
+// pages and takes a copy-on-write fault per page, and every
+// exit frees them all again. the number of forks, the pages
+// allocated per second and the spins on the allocator's locks,
+// from kmemstats(), are printed.
+
+#define DURATION 100
+#define KB 64
+#define TICKS_PER_SEC 10     // qemu's timer interrupt comes every 1/10th second
+
+void
+worker(int end, int kb, int res)
+{
+  int n = 0;
+  char *heap = sbrk(kb * 1024);
+
+  if(heap == (char*)-1)
+    exit(1);
+  memset(heap, 1, kb * 1024);
+  while(uptime() < end){
+    int pid = fork();
+    if(pid < 0)
+      break;
+    if(pid == 0){
+      for(int i = 0; i < kb * 1024; i += 4096)
+        heap[i] = 2;
+      exit(0);
+    }
+    wait(0);
+    n++;
+  }
+  write(res, &n, sizeof(n));
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nworkers = 0, duration = DURATION, kb = KB;
+  int res[2], forks = 0, n;
+  struct kmemstat before, after;
+  int mask = sched_getaffinity(0);
+
+  for(int i = 0; i < 32; i++)
+    if(mask & (1 << i))
+      nworkers++;
+  if(argc > 1)
+    nworkers = atoi(argv[1]);
+  if(argc > 2)
+    duration = atoi(argv[2]);
+  if(argc > 3)
+    kb = atoi(argv[3]);
+  if(nworkers < 1 || duration < 1 || kb < 1){
+    printf("usage: forkstorm [nworkers] [ticks] [kb]\n");
+    exit(1);
+  }
+  if(pipe(res) < 0){
+    printf("forkstorm: pipe failed\n");
+    exit(1);
+  }
+
+  kmemstats(&before);
+  int end = uptime() + duration;
+  for(int i = 0; i < nworkers; i++){
+    int pid = fork();
+    if(pid < 0){
+      printf("forkstorm: fork failed\n");
+      break;
+    }
+    if(pid == 0){
+      close(res[0]);
+      worker(end, kb, res[1]);
+    }
+  }
+  close(res[1]);
+  while(read(res[0], &n, sizeof(n)) == sizeof(n))
+    forks += n;
+  close(res[0]);
+  while(wait(0) >= 0)
+    ;
+  kmemstats(&after);
+
+  int secs10 = duration * 10 / TICKS_PER_SEC;   // tenths of a second
+  int pages = after.nalloc - before.nalloc;
+  printf("%d workers, %d KB heap, %d ticks\n", nworkers, kb, duration);
+  printf("forks: %d (%d/s)\n", forks, forks * 10 / secs10);
+  printf("pages allocated: %d (%d/s)\n", pages, pages * 10 / secs10);
+  printf("batches: %d refills, %d drains, %d steals\n",
+         (int)(after.nrefill - before.nrefill),
+         (int)(after.ndrain - before.ndrain),
+         (int)(after.nsteal - before.nsteal));
+  printf("spins: pool %d, caches %d\n",
+         (int)(after.poolspin - before.poolspin),
+         (int)(after.cachespin - before.cachespin));
+  exit(0);
+}
@@ -0,0 +1,150 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Lottery fairness over time.
+// usage: lotterytest [intervals] [tickets...]
+//
+// forks one CPU-bound process per ticket count, and every
+// INTERVAL ticks records how much work each one got done.
+// prints each process's share of the work in every interval
+// next to the share its tickets entitle it to. meant to be run
+// with CPUS=1 under LBS (setscheduler LBS), so that everyone competes for the
+// same hart.
+
+#define MAXCHILD 8
+#define MAXINTERVALS 32
+#define INTERVAL 20
+
+struct report {
+  int child;
+  int work[MAXINTERVALS];
+};
+
+void
+worker(int child, int tickets, int start, int nintervals, int fd)
+{
+  struct report r;
+  uint64 work = 0;
+  int k = 0;
+
+  settickets(tickets);
+  r.child = child;
+  while(uptime() < start)
+    sleep(1);
+
+  while(k < nintervals){
+    for(int i = 0; i < 4096; i++)
+      work++;
+    // log in units of 4096 iterations to keep the counts small.
+    while(k < nintervals && uptime() >= start + (k + 1) * INTERVAL)
+      r.work[k++] = work / 4096;
+  }
+  write(fd, &r, sizeof(r));
+  exit(0);
+}
+
+// read a whole n bytes; a pipe read returns whatever is there.
+int
+readall(int fd, void *buf, int n)
+{
+  int got = 0, m;
+
+  while(got < n){
+    if((m = read(fd, (char*)buf + got, n - got)) <= 0)
+      return -1;
+    got += m;
+  }
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int tickets[MAXCHILD] = {10, 20, 30, 40};
+  int nchild = 4, nintervals = 10;
+  int work[MAXCHILD][MAXINTERVALS];
+  int rfd[MAXCHILD];
+
+  if(argc > 1)
+    nintervals = atoi(argv[1]);
+  if(argc > 2){
+    nchild = 0;
+    for(int i = 2; i < argc && nchild < MAXCHILD; i++)
+      tickets[nchild++] = atoi(argv[i]);
+  }
+  if(nintervals < 1 || nintervals > MAXINTERVALS){
+    printf("usage: lotterytest [intervals] [tickets...]\n");
+    exit(1);
+  }
+
+  int total = 0;
+  for(int i = 0; i < nchild; i++){
+    if(tickets[i] < 1){
+      printf("lotterytest: tickets must be positive\n");
+      exit(1);
+    }
+    total += tickets[i];
+  }
+
+  // a pipe each: reports are bigger than a pipe holds all
+  // together, and a write that has to wait for room can be
+  // interleaved with another child's.
+  int start = uptime() + 10;
+  for(int i = 0; i < nchild; i++){
+    int fds[2];
+    if(pipe(fds) < 0){
+      printf("lotterytest: pipe failed\n");
+      exit(1);
+    }
+    int pid = fork();
+    if(pid < 0){
+      printf("lotterytest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(fds[0]);
+      worker(i, tickets[i], start, nintervals, fds[1]);
+    }
+    close(fds[1]);
+    rfd[i] = fds[0];
+  }
+
+  struct report r;
+  for(int i = 0; i < nchild; i++){
+    if(readall(rfd[i], &r, sizeof(r)) < 0){
+      printf("lotterytest: short read\n");
+      exit(1);
+    }
+    close(rfd[i]);
+    for(int k = 0; k < nintervals; k++)
+      work[r.child][k] = r.work[k];
+  }
+  while(wait(0) >= 0)
+    ;
+
+  printf("interval");
+  for(int i = 0; i < nchild; i++)
+    printf("  t=%d(%d%%)", tickets[i], tickets[i] * 100 / total);
+  printf("\n");
+  for(int k = 0; k < nintervals; k++){
+    int sum = 0;
+    for(int i = 0; i < nchild; i++)
+      sum += work[i][k] - (k ? work[i][k-1] : 0);
+    printf("%d", k);
+    for(int i = 0; i < nchild; i++){
+      int done = work[i][k] - (k ? work[i][k-1] : 0);
+      printf("  %d%%", sum ? done * 100 / sum : 0);
+    }
+    printf("\n");
+  }
+
+  int sum = 0;
+  for(int i = 0; i < nchild; i++)
+    sum += work[i][nintervals-1];
+  printf("overall");
+  for(int i = 0; i < nchild; i++)
+    printf("  %d%%", sum ? work[i][nintervals-1] * 100 / sum : 0);
+  printf("\n");
+  exit(0);
+}
@@ -0,0 +1,102 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// CPU affinity benchmark.
+// usage: pinbench [nworkers] [ticks] [kb]
+//
+// nworkers processes each sweep a kb-kilobyte buffer over and
+// over for the given number of ticks, writing one byte in every
+// 64, and the total number of sweeps is reported. this is done
+// twice: first with the workers free to run on any hart, then
+// with worker i pinned to the i-th online hart (wrapping
+// around) with sched_setaffinity(). with more workers than
+// harts, the free ones keep being moved between harts while the
+// pinned ones stay where their buffer is cache-hot.
+
+#define DURATION 100
+#define KB 256
+
+int
+sweep(char *buf, int n, int end)
+{
+  int passes = 0;
+
+  while(uptime() < end){
+    for(int i = 0; i < n; i += 64)
+      buf[i]++;
+    passes++;
+  }
+  return passes;
+}
+
+// run nworkers for duration ticks, pinned if harts is not 0,
+// and return the total number of sweeps.
+int
+run(int nworkers, int duration, int kb, int *harts, int nharts)
+{
+  int res[2], total = 0, n;
+
+  if(pipe(res) < 0){
+    printf("pinbench: pipe failed\n");
+    exit(1);
+  }
+  int end = uptime() + duration;
+  for(int i = 0; i < nworkers; i++){
+    int pid = fork();
+    if(pid < 0){
+      printf("pinbench: fork failed\n");
+      break;
+    }
+    if(pid == 0){
+      close(res[0]);
+      if(nharts && sched_setaffinity(0, 1 << harts[i % nharts]) < 0){
+        printf("pinbench: sched_setaffinity failed\n");
+        exit(1);
+      }
+      char *buf = malloc(kb * 1024);
+      memset(buf, 0, kb * 1024);
+      n = sweep(buf, kb * 1024, end);
+      write(res[1], &n, sizeof(n));
+      exit(0);
+    }
+  }
+  close(res[1]);
+  while(read(res[0], &n, sizeof(n)) == sizeof(n))
+    total += n;
+  close(res[0]);
+  while(wait(0) >= 0)
+    ;
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int harts[32], nharts = 0;
+  int mask = sched_getaffinity(0);
+
+  for(int i = 0; i < 32; i++)
+    if(mask & (1 << i))
+      harts[nharts++] = i;
+
+  int nworkers = nharts + 1, duration = DURATION, kb = KB;
+  if(argc > 1)
+    nworkers = atoi(argv[1]);
+  if(argc > 2)
+    duration = atoi(argv[2]);
+  if(argc > 3)
+    kb = atoi(argv[3]);
+  if(nworkers < 1 || duration < 1 || kb < 1 || nharts == 0){
+    printf("usage: pinbench [nworkers] [ticks] [kb]\n");
+    exit(1);
+  }
+
+  printf("%d workers, %d KB each, %d harts, %d ticks\n",
+         nworkers, kb, nharts, duration);
+  int unpinned = run(nworkers, duration, kb, 0, 0);
+  printf("free:   %d sweeps (%d per tick)\n", unpinned, unpinned / duration);
+  int pinned = run(nworkers, duration, kb, harts, nharts);
+  printf("pinned: %d sweeps (%d per tick)\n", pinned, pinned / duration);
+  exit(0);
+}
@@ -0,0 +1,135 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+#include "kernel/sysctl.h"
+
+// Priority inversion test for sleeplock priority inheritance.
+// usage: pitest [nhogs] [samples]
+//
+// a low-priority writer keeps rewriting a file bigger than the
+// buffer cache, so it often sleeps for the disk while holding
+// the file's inode lock, and nhogs processes of middling
+// priority keep the harts busy, computing for two ticks and
+// sleeping for one. the high-priority parent stats the file
+// once a tick, which needs the inode lock, and the number of
+// ticks the stats took is printed: first with the sched.inherit
+// sysctl off, then with it on. run it under PBS or MLFQ; the
+// other policies have no priorities to lend.
+
+#define NHOGS 8
+#define NSAMPLES 50
+#define FILEKB 64
+
+char buf[4096];
+
+void
+writer(void)
+{
+  int fd;
+
+  set_priority(90, getpid());
+  for(;;){
+    if((fd = open("pifile", O_WRONLY)) < 0){
+      printf("pitest: open pifile failed\n");
+      exit(1);
+    }
+    for(int i = 0; i < FILEKB * 1024 / sizeof(buf); i++)
+      write(fd, buf, sizeof(buf));
+    close(fd);
+  }
+}
+
+void
+hog(void)
+{
+  volatile int x = 0;
+
+  for(;;){
+    int t = uptime();
+    while(uptime() < t + 2)
+      x++;
+    sleep(1);
+  }
+}
+
+// stat pifile nsamples times while the writer and the hogs run,
+// and return the total number of ticks it took; the longest
+// single stat goes in *worst.
+int
+run(int inherit, int nhogs, int nsamples, int *worst)
+{
+  int pids[NHOGS + 1], n = 0, total = 0, fd;
+  struct stat st;
+
+  if(sysctl(CTL_SCHED_INHERIT, 0, &inherit) < 0){
+    printf("pitest: sysctl failed\n");
+    exit(1);
+  }
+  if((pids[n++] = fork()) == 0)
+    writer();
+  for(int i = 0; i < nhogs; i++)
+    if((pids[n++] = fork()) == 0)
+      hog();
+  sleep(10);
+
+  if((fd = open("pifile", O_RDONLY)) < 0){
+    printf("pitest: open pifile failed\n");
+    exit(1);
+  }
+  *worst = 0;
+  for(int i = 0; i < nsamples; i++){
+    sleep(1);
+    int t = uptime();
+    fstat(fd, &st);
+    t = uptime() - t;
+    total += t;
+    if(t > *worst)
+      *worst = t;
+  }
+  close(fd);
+
+  for(int i = 0; i < n; i++)
+    if(pids[i] > 0)
+      kill(pids[i]);
+  while(wait(0) >= 0)
+    ;
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhogs = NHOGS, nsamples = NSAMPLES;
+  int old, fd, worst, total;
+
+  if(argc > 1)
+    nhogs = atoi(argv[1]);
+  if(argc > 2)
+    nsamples = atoi(argv[2]);
+  if(nhogs < 0 || nhogs > NHOGS || nsamples < 1){
+    printf("usage: pitest [nhogs (0-%d)] [samples]\n", NHOGS);
+    exit(1);
+  }
+
+  if((fd = open("pifile", O_CREATE | O_WRONLY)) < 0){
+    printf("pitest: create pifile failed\n");
+    exit(1);
+  }
+  for(int i = 0; i < FILEKB * 1024 / sizeof(buf); i++)
+    write(fd, buf, sizeof(buf));
+  close(fd);
+
+  sysctl(CTL_SCHED_INHERIT, &old, 0);
+  set_priority(10, getpid());
+
+  printf("%d hogs, %d stats\n", nhogs, nsamples);
+  total = run(0, nhogs, nsamples, &worst);
+  printf("inheritance off: %d ticks, worst %d\n", total, worst);
+  total = run(1, nhogs, nsamples, &worst);
+  printf("inheritance on:  %d ticks, worst %d\n", total, worst);
+
+  sysctl(CTL_SCHED_INHERIT, 0, &old);
+  unlink("pifile");
+  exit(0);
+}
@@ -0,0 +1,94 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/param.h"
+#include "kernel/rusage.h"
+
+// CPU bandwidth quota test.
+// usage: quotatest [ticks]
+//
+// two groups of spinners are given quotas with setcpuquota():
+// group 1 gets Q1 ticks in every PERIOD, group 2 gets Q2, and
+// each has NPERGROUP processes sharing it. one more spinner is
+// left in group 0 with no limit. they all spin for the given
+// number of ticks, and the cpu time each group got, from
+// waitx(), is printed as a percentage of one hart next to the
+// percentage its quota allows.
+
+#define DURATION 200
+#define PERIOD 10
+#define Q1 2
+#define Q2 5
+#define NPERGROUP 2
+
+void
+spinner(int gid, int end)
+{
+  volatile int x = 0;
+
+  if(setcpugroup(0, gid) < 0){
+    printf("quotatest: setcpugroup failed\n");
+    exit(1);
+  }
+  while(uptime() < end)
+    x++;
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int duration = DURATION;
+  int gid[3 * NPERGROUP], pid[3 * NPERGROUP], n = 0;
+  uint64 run[3] = { 0, 0, 0 };
+  struct rusage ru;
+  int wtime, rtime;
+
+  if(argc > 1)
+    duration = atoi(argv[1]);
+  if(duration < PERIOD){
+    printf("usage: quotatest [ticks]\n");
+    exit(1);
+  }
+  if(setcpuquota(1, Q1, PERIOD) < 0 || setcpuquota(2, Q2, PERIOD) < 0){
+    printf("quotatest: setcpuquota failed\n");
+    exit(1);
+  }
+
+  int end = uptime() + duration;
+  for(int g = 1; g <= 2; g++){
+    for(int i = 0; i < NPERGROUP; i++){
+      gid[n] = g;
+      if((pid[n] = fork()) == 0)
+        spinner(g, end);
+      n++;
+    }
+  }
+  gid[n] = 0;
+  if((pid[n] = fork()) == 0)
+    spinner(0, end);
+  n++;
+
+  for(int k = 0; k < n; k++){
+    int p = waitx(0, &wtime, &rtime, &ru);
+    if(p < 0)
+      break;
+    for(int i = 0; i < n; i++)
+      if(pid[i] == p)
+        run[gid[i]] += ru.ru_run;
+  }
+
+  setcpuquota(1, 0, 0);
+  setcpuquota(2, 0, 0);
+
+  // percent of one hart over the run.
+  uint64 hart = (uint64)duration * TIMERINTERVAL;
+  printf("%d ticks, period %d\n", duration, PERIOD);
+  printf("group 1 (%d procs, quota %d): %d%% of a hart, expected %d%%\n",
+         NPERGROUP, Q1, (int)(run[1] * 100 / hart), Q1 * 100 / PERIOD);
+  printf("group 2 (%d procs, quota %d): %d%% of a hart, expected %d%%\n",
+         NPERGROUP, Q2, (int)(run[2] * 100 / hart), Q2 * 100 / PERIOD);
+  printf("uncapped (1 proc):           %d%% of a hart\n",
+         (int)(run[0] * 100 / hart));
+  exit(0);
+}
@@ -0,0 +1,144 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Scheduler throughput benchmark.
+// usage: schedbench [npairs] [ticks] [nidle]
+//
+// npairs pairs of processes bounce a byte back and forth over
+// two pipes for the given number of ticks. every round trip puts
+// both processes to sleep and wakes them up again, so it goes
+// through the scheduler twice. run it with different CPUS= to see
+// how the run queue locks hold up as harts are added.
+//
+// nidle more processes sleep on a pipe that never gets written
+// for the whole run, to see what sleepers that are never woken
+// cost every wakeup(); try schedbench 1 100 60.
+
+#define NPAIRS 8
+#define DURATION 100
+
+// bounce bytes until the deadline and report how many round trips.
+void
+ping(int out, int in, int end, int res)
+{
+  int n = 0;
+  char c = 'x';
+
+  while(uptime() < end){
+    if(write(out, &c, 1) != 1 || read(in, &c, 1) != 1)
+      break;
+    n++;
+  }
+  close(out);
+  write(res, &n, sizeof(n));
+  exit(0);
+}
+
+// echo bytes back until the other side hangs up.
+void
+pong(int in, int out)
+{
+  char c;
+
+  while(read(in, &c, 1) == 1){
+    if(write(out, &c, 1) != 1)
+      break;
+  }
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int npairs = NPAIRS, duration = DURATION, nidle = 0;
+  int res[2], a[2], b[2], idle[2];
+
+  if(argc > 1)
+    npairs = atoi(argv[1]);
+  if(argc > 2)
+    duration = atoi(argv[2]);
+  if(argc > 3)
+    nidle = atoi(argv[3]);
+  if(npairs < 1 || duration < 1 || nidle < 0){
+    printf("usage: schedbench [npairs] [ticks] [nidle]\n");
+    exit(1);
+  }
+
+  if(pipe(res) < 0 || pipe(idle) < 0){
+    printf("schedbench: pipe failed\n");
+    exit(1);
+  }
+
+  // the idle processes exit once idle's write end is closed.
+  for(int i = 0; i < nidle; i++){
+    int pid = fork();
+    if(pid == 0){
+      char c;
+      close(res[0]);
+      close(res[1]);
+      close(idle[1]);
+      read(idle[0], &c, 1);
+      exit(0);
+    }
+    if(pid < 0){
+      printf("schedbench: fork failed after %d idle processes\n", i);
+      nidle = i;
+      break;
+    }
+  }
+  close(idle[0]);
+
+  int start = uptime();
+  int end = start + duration;
+  int started = 0;
+  for(int i = 0; i < npairs; i++){
+    if(pipe(a) < 0 || pipe(b) < 0){
+      printf("schedbench: pipe failed\n");
+      break;
+    }
+    int pid = fork();
+    if(pid == 0){
+      close(idle[1]);
+      close(res[0]);
+      close(a[0]);
+      close(b[1]);
+      ping(a[1], b[0], end, res[1]);
+    }
+    if(pid > 0 && fork() == 0){
+      close(idle[1]);
+      close(res[0]);
+      close(res[1]);
+      close(a[1]);
+      close(b[0]);
+      pong(a[0], b[1]);
+    }
+    close(a[0]);
+    close(a[1]);
+    close(b[0]);
+    close(b[1]);
+    if(pid < 0){
+      printf("schedbench: fork failed\n");
+      break;
+    }
+    started++;
+  }
+  close(res[1]);
+
+  int total = 0, n;
+  for(int i = 0; i < started; i++){
+    if(read(res[0], &n, sizeof(n)) != sizeof(n))
+      break;
+    total += n;
+  }
+  close(idle[1]);
+  while(wait(0) >= 0)
+    ;
+
+  int elapsed = uptime() - start;
+  if(elapsed < 1)
+    elapsed = 1;
+  printf("%d pairs, %d idle: %d round trips in %d ticks (%d per tick)\n",
+         started, nidle, total, elapsed, total / elapsed);
+  exit(0);
+}
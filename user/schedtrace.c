@@ -0,0 +1,98 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+#include "kernel/sysctl.h"
+#include "kernel/schedtrace.h"
+#include "kernel/rusage.h"
+
+// usage: schedtrace [-q] [ticks]
+// records scheduler events for the given number of ticks
+// (default 100) and prints them as they are drained from the
+// kernel's per-cpu rings, one per line:
+//   time in us,cpu,pid,event,arg
+// with -q, prints instead a line every time a process starts
+// running or changes MLFQ level, in the pid,queue,ticks,state
+// form that makegraph.py reads. run the workload in the
+// background, e.g. schedulertest &; schedtrace -q 300
+
+#define NEVBUF 64
+
+static char *evnames[NEV] = {
+  [EV_SWITCHIN]  "in",
+  [EV_SWITCHOUT] "out",
+  [EV_WAKEUP]    "wakeup",
+  [EV_QUEUE]     "queue",
+  [EV_MIGRATE]   "migrate",
+  [EV_DROPPED]   "dropped",
+};
+
+struct schedev buf[NEVBUF];
+int qflag;
+
+void
+print(struct schedev *e)
+{
+  if(!qflag){
+    printf("%l,%d,%d,%s,%d\n", e->time / (TIMEBASE_HZ / 1000000),
+           e->cpu, e->pid, evnames[(int)e->type], e->arg);
+  } else if(e->type == EV_DROPPED){
+    printf("# %d events dropped on cpu %d\n", e->arg, e->cpu);
+  } else if(e->pid > 2 && e->type == EV_SWITCHIN){
+    printf("%d,%d,%d,Running\n", e->pid, e->arg, (int)(e->time / TIMERINTERVAL));
+  } else if(e->pid > 2 && e->type == EV_QUEUE){
+    printf("%d,%d,%d,Runnable\n", e->pid, e->arg, (int)(e->time / TIMERINTERVAL));
+  }
+}
+
+// print what the rings hold; returns how many events there were.
+int
+drain(void)
+{
+  int n, total = 0;
+
+  while((n = schedtrace(buf, NEVBUF)) > 0){
+    for(int i = 0; i < n; i++)
+      print(&buf[i]);
+    total += n;
+  }
+  if(n < 0){
+    printf("schedtrace: schedtrace failed\n");
+    exit(1);
+  }
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int duration = 100, on = 1, off = 0;
+  int i = 1;
+
+  if(i < argc && strcmp(argv[i], "-q") == 0){
+    qflag = 1;
+    i++;
+  }
+  if(i < argc)
+    duration = atoi(argv[i++]);
+  if(i != argc || duration < 1){
+    printf("usage: schedtrace [-q] [ticks]\n");
+    exit(1);
+  }
+
+  // throw away anything left over from an earlier run.
+  while(schedtrace(buf, NEVBUF) > 0)
+    ;
+  if(sysctl(CTL_SCHED_TRACE, 0, &on) < 0){
+    printf("schedtrace: cannot turn tracing on\n");
+    exit(1);
+  }
+  int end = uptime() + duration;
+  while(uptime() < end){
+    if(drain() == 0)
+      sleep(1);
+  }
+  sysctl(CTL_SCHED_TRACE, 0, &off);
+  drain();
+  exit(0);
+}
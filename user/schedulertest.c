@@ -2,21 +2,40 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/sched.h"
+#include "kernel/rusage.h"
 
 
 #define NFORK 10
 #define IO 5
 
-int main() {
+// usage: schedulertest [nfork]
+// half of the forked processes are IO bound, half CPU bound.
+int main(int argc, char *argv[]) {
   int n, pid;
   int wtime, rtime;
   int twtime=0, trtime=0;
-  for (n=0; n < NFORK;n++) {
+  struct rusage ru;
+  uint64 trun=0, twait=0;
+  int nfork = NFORK, io = IO;
+  int policy = setscheduler(-1);
+
+  if (argc > 1) {
+    nfork = atoi(argv[1]);
+    io = nfork / 2;
+  }
+  if (nfork < 1) {
+    printf("usage: schedulertest [nfork]\n");
+    exit(1);
+  }
+
+  int start = uptime();
+  for (n=0; n < nfork;n++) {
       pid = fork();
       if (pid < 0)
           break;
       if (pid == 0) {
-          if (n < IO) {
+          if (n < io) {
             sleep(200); // IO bound processes
           } else {
             for (int i = 0; i < 1000000000; i++) {}; // CPU bound process
@@ -24,17 +43,28 @@ int main() {
           // printf("Process %d finished", n);
           exit(0);
       } else {
-#ifdef PBS
-        set_priority(60-IO+n, pid); // Will only matter for PBS, set lower priority for IO bound processes 
-#endif
+        if (policy == SCHED_PBS || policy == SCHED_CFS)
+          set_priority(60-io+n, pid); // Will only matter for PBS and CFS, set lower priority for IO bound processes
       }
   }
+  if (n < nfork)
+    printf("fork failed after %d processes\n", n);
+  nfork = n;
   for(;n > 0; n--) {
-      if(waitx(0,&wtime,&rtime) >= 0) {
+      if(waitx(0,&wtime,&rtime,&ru) >= 0) {
           trtime += rtime;
           twtime += wtime;
-      } 
+          trun += ru.ru_run;
+          twait += ru.ru_wait;
+      }
+  }
+  if (nfork > 0) {
+    printf("Average rtime %d,  wtime %d\n", trtime / nfork, twtime / nfork);
+    // the same from cycle counts, in microseconds; wtime above also counts sleeping.
+    printf("Average run %d us, runnable %d us\n",
+           (int)(trun / nfork / (TIMEBASE_HZ / 1000000)),
+           (int)(twait / nfork / (TIMEBASE_HZ / 1000000)));
   }
-  printf("Average rtime %d,  wtime %d\n", trtime / NFORK, twtime / NFORK);
+  printf("%d processes finished in %d ticks\n", nfork, uptime() - start);
   exit(0);
 }
@@ -0,0 +1,47 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/sched.h"
+
+// usage: setscheduler [policy]
+// with no argument, prints the active scheduling policy.
+// otherwise switches the running kernel over to policy;
+// processes waiting to run are moved over to it as well.
+
+static char *names[NSCHED] = {
+  [SCHED_RR]     "RR",
+  [SCHED_FCFS]   "FCFS",
+  [SCHED_LBS]    "LBS",
+  [SCHED_PBS]    "PBS",
+  [SCHED_MLFQ]   "MLFQ",
+  [SCHED_STRIDE] "STRIDE",
+  [SCHED_CFS]    "CFS",
+};
+
+int
+main(int argc, char *argv[])
+{
+  int policy, old;
+
+  if(argc == 1){
+    printf("%s\n", names[setscheduler(-1)]);
+    exit(0);
+  }
+
+  for(policy = 0; policy < NSCHED; policy++){
+    if(strcmp(argv[1], names[policy]) == 0)
+      break;
+  }
+  if(argc != 2 || policy == NSCHED){
+    printf("Usage: setscheduler [RR|FCFS|LBS|PBS|MLFQ|STRIDE|CFS]\n");
+    exit(1);
+  }
+
+  old = setscheduler(policy);
+  if(old < 0){
+    printf("setscheduler: failed\n");
+    exit(1);
+  }
+  printf("%s -> %s\n", names[old], names[policy]);
+  exit(0);
+}
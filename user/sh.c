@@ -3,6 +3,7 @@
 #include "kernel/types.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/spawn.h"
 
 // Parsed command representation
 #define EXEC  1
@@ -52,7 +53,13 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
 void runcmd(struct cmd*) __attribute__((noreturn));
+void runchild(struct cmd*, struct spawnact*, int);
+
+// sh -f forks a copy of itself to run every command, as it
+// did before spawn(); spawnbench compares the two.
+int usefork;
 
 // Execute cmd.  Never returns.
 void
@@ -92,8 +99,7 @@ runcmd(struct cmd *cmd)
 
   case LIST:
     lcmd = (struct listcmd*)cmd;
-    if(fork1() == 0)
-      runcmd(lcmd->left);
+    runchild(lcmd->left, 0, 0);
     wait(0);
     runcmd(lcmd->right);
     break;
@@ -102,20 +108,15 @@ runcmd(struct cmd *cmd)
     pcmd = (struct pipecmd*)cmd;
     if(pipe(p) < 0)
       panic("pipe");
-    if(fork1() == 0){
-      close(1);
-      dup(p[1]);
-      close(p[0]);
-      close(p[1]);
-      runcmd(pcmd->left);
-    }
-    if(fork1() == 0){
-      close(0);
-      dup(p[0]);
-      close(p[0]);
-      close(p[1]);
-      runcmd(pcmd->right);
-    }
+    struct spawnact act[3] = {
+      { SPAWN_DUP, 1, p[1] },
+      { SPAWN_CLOSE, p[0] },
+      { SPAWN_CLOSE, p[1] },
+    };
+    runchild(pcmd->left, act, 3);
+    act[0].fd = 0;
+    act[0].arg = p[0];
+    runchild(pcmd->right, act, 3);
     close(p[0]);
     close(p[1]);
     wait(0);
@@ -124,13 +125,82 @@ runcmd(struct cmd *cmd)
 
   case BACK:
     bcmd = (struct backcmd*)cmd;
-    if(fork1() == 0)
-      runcmd(bcmd->cmd);
+    runchild(bcmd->cmd, 0, 0);
     break;
   }
   exit(0);
 }
 
+// Do the file actions act[0..nact) to this process's own
+// open files, as spawn() does to a child's.
+void
+doacts(struct spawnact *act, int nact)
+{
+  for(int i = 0; i < nact; i++){
+    close(act[i].fd);
+    if(act[i].op == SPAWN_DUP)
+      dup(act[i].arg);
+    else if(act[i].op == SPAWN_OPEN && open(act[i].path, act[i].arg) < 0){
+      fprintf(2, "open %s failed\n", act[i].path);
+      exit(1);
+    }
+  }
+}
+
+// Start cmd with spawn(), if it is a program to run, with
+// or without redirections, after the file actions
+// act[0..nact). Returns the child's pid, 0 if there was
+// nothing to start or it couldn't be started, or -1 if
+// cmd needs a shell of its own to run it.
+int
+spawncmd(struct cmd *cmd, struct spawnact *act, int nact)
+{
+  struct spawnact all[NSPAWNACT];
+  struct execcmd *ecmd;
+  struct redircmd *rcmd;
+  int n, pid;
+
+  if(usefork)
+    return -1;
+  for(n = 0; n < nact; n++)
+    all[n] = act[n];
+  // runcmd() does the outermost redirection first.
+  for(; cmd->type == REDIR; cmd = rcmd->cmd){
+    rcmd = (struct redircmd*)cmd;
+    if(n == NSPAWNACT)
+      return -1;
+    all[n].op = SPAWN_OPEN;
+    all[n].fd = rcmd->fd;
+    all[n].arg = rcmd->mode;
+    all[n].path = rcmd->file;
+    n++;
+  }
+  if(cmd->type != EXEC)
+    return -1;
+  ecmd = (struct execcmd*)cmd;
+  if(ecmd->argv[0] == 0)
+    return n == 0 ? 0 : -1;   // a blank line
+  if((pid = spawn(ecmd->argv[0], ecmd->argv, all, n)) < 0){
+    fprintf(2, "exec %s failed\n", ecmd->argv[0]);
+    return 0;
+  }
+  return pid;
+}
+
+// Run cmd in a child process, after the file actions
+// act[0..nact): spawn() it if it's a program, else fork a
+// copy of the shell to run it. The caller waits for it.
+void
+runchild(struct cmd *cmd, struct spawnact *act, int nact)
+{
+  if(spawncmd(cmd, act, nact) >= 0)
+    return;
+  if(fork1() == 0){
+    doacts(act, nact);
+    runcmd(cmd);
+  }
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -143,11 +213,15 @@ getcmd(char *buf, int nbuf)
 }
 
 int
-main(void)
+main(int argc, char *argv[])
 {
   static char buf[100];
+  struct cmd *cmd;
   int fd;
 
+  if(argc > 1 && strcmp(argv[1], "-f") == 0)
+    usefork = 1;
+
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
     if(fd >= 3){
@@ -165,9 +239,13 @@ main(void)
         fprintf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
+    // parsed here, not in a child, so that a plain command
+    // can be spawned without forking the shell first.
+    if((cmd = parsecmd(buf)) == 0)
+      continue;
+    runchild(cmd, 0, 0);
     wait(0);
+    freecmd(cmd);
   }
   exit(0);
 }
@@ -325,18 +403,36 @@ struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
 struct cmd *nulterminate(struct cmd*);
 
+// The shell itself parses commands, so a syntax error
+// can't just panic; it is noted here instead, and
+// parsecmd() returns 0.
+int parseerr;
+
+void
+syntax(char *msg)
+{
+  if(!parseerr)
+    fprintf(2, "%s\n", msg);
+  parseerr = 1;
+}
+
 struct cmd*
 parsecmd(char *s)
 {
   char *es;
   struct cmd *cmd;
 
+  parseerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
+  if(s != es && !parseerr){
     fprintf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
+  }
+  if(parseerr){
+    freecmd(cmd);
+    return 0;
   }
   nulterminate(cmd);
   return cmd;
@@ -380,8 +476,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -406,8 +504,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -432,13 +532,17 @@ parseexec(char **ps, char *es)
   while(!peek(ps, es, "|)&;")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
+    if(argc + 1 >= MAXARGS){
+      syntax("too many args");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
@@ -492,3 +596,41 @@ nulterminate(struct cmd *cmd)
   }
   return cmd;
 }
+
+// Free a parsed command.
+void
+freecmd(struct cmd *cmd)
+{
+  struct backcmd *bcmd;
+  struct listcmd *lcmd;
+  struct pipecmd *pcmd;
+  struct redircmd *rcmd;
+
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    freecmd(rcmd->cmd);
+    break;
+
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    freecmd(pcmd->left);
+    freecmd(pcmd->right);
+    break;
+
+  case LIST:
+    lcmd = (struct listcmd*)cmd;
+    freecmd(lcmd->left);
+    freecmd(lcmd->right);
+    break;
+
+  case BACK:
+    bcmd = (struct backcmd*)cmd;
+    freecmd(bcmd->cmd);
+    break;
+  }
+  free(cmd);
+}
@@ -0,0 +1,144 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/sched.h"
+
+// Proportional-share drift test for LBS and STRIDE.
+// usage: sharetest [windows] [tickets...]
+//
+// forks one CPU-bound process per ticket count and samples how
+// much work each has done every WINDOW ticks. for every process
+// it reports, in tenths of a percent of the total work:
+//   window: mean and worst error of its share in a single window
+//   drift:  worst gap between its cumulative work and what its
+//           tickets entitle it to, at any window boundary
+// run with CPUS=1 so that all processes compete for one hart.
+
+#define MAXCHILD 8
+#define MAXWINDOWS 64
+#define WINDOW 5
+
+struct report {
+  int child;
+  int work[MAXWINDOWS];
+};
+
+int
+iabs(int x)
+{
+  return x < 0 ? -x : x;
+}
+
+void
+worker(int child, int tickets, int start, int nwindows, int fd)
+{
+  struct report r;
+  uint64 work = 0;
+  int k = 0;
+
+  settickets(tickets);
+  r.child = child;
+  while(uptime() < start)
+    sleep(1);
+
+  while(k < nwindows){
+    for(int i = 0; i < 4096; i++)
+      work++;
+    while(k < nwindows && uptime() >= start + (k + 1) * WINDOW)
+      r.work[k++] = work / 4096;
+  }
+  write(fd, &r, sizeof(r));
+  exit(0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int tickets[MAXCHILD] = {10, 20, 30, 40};
+  int nchild = 4, nwindows = 40;
+  int work[MAXCHILD][MAXWINDOWS];
+  int fds[2];
+
+  if(argc > 1)
+    nwindows = atoi(argv[1]);
+  if(argc > 2){
+    nchild = 0;
+    for(int i = 2; i < argc && nchild < MAXCHILD; i++)
+      tickets[nchild++] = atoi(argv[i]);
+  }
+  if(nwindows < 1 || nwindows > MAXWINDOWS){
+    printf("usage: sharetest [windows] [tickets...]\n");
+    exit(1);
+  }
+
+  int total = 0;
+  for(int i = 0; i < nchild; i++){
+    if(tickets[i] < 1){
+      printf("sharetest: tickets must be positive\n");
+      exit(1);
+    }
+    total += tickets[i];
+  }
+
+  if(pipe(fds) < 0){
+    printf("sharetest: pipe failed\n");
+    exit(1);
+  }
+  int start = uptime() + 10;
+  for(int i = 0; i < nchild; i++){
+    int pid = fork();
+    if(pid < 0){
+      printf("sharetest: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(fds[0]);
+      worker(i, tickets[i], start, nwindows, fds[1]);
+    }
+  }
+  close(fds[1]);
+
+  struct report r;
+  for(int i = 0; i < nchild; i++){
+    if(read(fds[0], &r, sizeof(r)) != sizeof(r)){
+      printf("sharetest: short read\n");
+      exit(1);
+    }
+    for(int k = 0; k < nwindows; k++)
+      work[r.child][k] = r.work[k];
+  }
+  while(wait(0) >= 0)
+    ;
+
+  int policy = setscheduler(-1);
+  if(policy == SCHED_STRIDE)
+    printf("STRIDE");
+  else if(policy == SCHED_LBS)
+    printf("LBS");
+  else
+    printf("(tickets ignored by this scheduler)");
+  printf(": %d windows of %d ticks, errors in 0.1%%\n", nwindows, WINDOW);
+  printf("tickets  target  window-mean  window-max  drift-max\n");
+  for(int i = 0; i < nchild; i++){
+    int target = tickets[i] * 1000 / total;
+    int errsum = 0, errmax = 0, drift = 0;
+    for(int k = 0; k < nwindows; k++){
+      int sum = 0, cum = 0;
+      for(int j = 0; j < nchild; j++){
+        sum += work[j][k] - (k ? work[j][k-1] : 0);
+        cum += work[j][k];
+      }
+      int done = work[i][k] - (k ? work[i][k-1] : 0);
+      int err = sum ? iabs(done * 1000 / sum - target) : 0;
+      errsum += err;
+      if(err > errmax)
+        errmax = err;
+      err = cum ? iabs(work[i][k] * 1000 / cum - target) : 0;
+      if(err > drift)
+        drift = err;
+    }
+    printf("%d  %d  %d  %d  %d\n", tickets[i], target,
+           errsum / nwindows, errmax, drift);
+  }
+  exit(0);
+}
@@ -0,0 +1,87 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+#include "kernel/spawn.h"
+
+// Shell command rate benchmark.
+// usage: spawnbench [ncmds]
+//
+// a script of ncmds trivial commands (echo with no arguments)
+// is written to a file and run by sh twice: first as sh -f,
+// which forks a copy of itself for every command as it always
+// used to, then as plain sh, which spawn()s them. sh's output
+// and prompts go down a pipe that is read and thrown away. the
+// ticks each run took and the commands per second are printed.
+
+#define NCMDS 1000
+#define SCRIPT "spawnbench.sh"
+#define TICKS_PER_SEC 10     // qemu's timer interrupt comes every 1/10th second
+
+// run sh with the given flag on the script, and return the
+// number of ticks it took.
+int
+run(char *flag)
+{
+  char *argv[] = { "sh", flag, 0 };
+  char buf[512];
+  int p[2], pid;
+
+  if(pipe(p) < 0){
+    printf("spawnbench: pipe failed\n");
+    exit(1);
+  }
+  struct spawnact act[] = {
+    { SPAWN_OPEN, 0, O_RDONLY, SCRIPT },
+    { SPAWN_DUP, 1, p[1] },
+    { SPAWN_DUP, 2, p[1] },
+    { SPAWN_CLOSE, p[0] },
+    { SPAWN_CLOSE, p[1] },
+  };
+
+  int start = uptime();
+  if((pid = spawn("sh", argv, act, 5)) < 0){
+    printf("spawnbench: spawn sh failed\n");
+    exit(1);
+  }
+  close(p[1]);
+  while(read(p[0], buf, sizeof(buf)) > 0)
+    ;
+  close(p[0]);
+  wait(0);
+  return uptime() - start;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int ncmds = NCMDS, fd;
+
+  if(argc > 1)
+    ncmds = atoi(argv[1]);
+  if(ncmds < 1){
+    printf("usage: spawnbench [ncmds]\n");
+    exit(1);
+  }
+
+  if((fd = open(SCRIPT, O_CREATE | O_TRUNC | O_WRONLY)) < 0){
+    printf("spawnbench: create %s failed\n", SCRIPT);
+    exit(1);
+  }
+  for(int i = 0; i < ncmds; i++)
+    write(fd, "echo\n", 5);
+  close(fd);
+
+  printf("%d commands\n", ncmds);
+  for(int i = 0; i < 2; i++){
+    char *flag = i == 0 ? "-f" : 0;
+    int t = run(flag);
+    if(t < 1)
+      t = 1;
+    printf("%s: %d ticks, %d commands/s\n", flag ? "fork+exec" : "spawn",
+           t, ncmds * TICKS_PER_SEC / t);
+  }
+
+  unlink(SCRIPT);
+  exit(0);
+}
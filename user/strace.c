@@ -11,7 +11,10 @@ int main(int argc, char *argv[])
     return 1;
   }
 
-  int mask = atoi(argv[1]);
+  // atoi() stops at 32 bits; system calls go past 31.
+  uint64 mask = 0;
+  for (char *s = argv[1]; *s >= '0' && *s <= '9'; s++)
+    mask = mask * 10 + (*s - '0');
   char *procName = argv[2];
   char *args[argc - 1];
 
@@ -0,0 +1,73 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/sysctl.h"
+
+// usage: sysctl [name[=value] ...]
+// with no argument, prints every kernel parameter.
+// otherwise prints each named parameter, or sets it
+// to value first.
+
+static char *names[NCTL] = {
+  [CTL_MLFQ_LEVELS]     "mlfq.levels",
+  [CTL_MLFQ_BOOST]      "mlfq.boost",
+  [CTL_MLFQ_SLICE + 0]  "mlfq.slice0",
+  [CTL_MLFQ_SLICE + 1]  "mlfq.slice1",
+  [CTL_MLFQ_SLICE + 2]  "mlfq.slice2",
+  [CTL_MLFQ_SLICE + 3]  "mlfq.slice3",
+  [CTL_MLFQ_SLICE + 4]  "mlfq.slice4",
+  [CTL_MLFQ_AGE + 0]    "mlfq.age0",
+  [CTL_MLFQ_AGE + 1]    "mlfq.age1",
+  [CTL_MLFQ_AGE + 2]    "mlfq.age2",
+  [CTL_MLFQ_AGE + 3]    "mlfq.age3",
+  [CTL_MLFQ_AGE + 4]    "mlfq.age4",
+  [CTL_SCHED_TRACE]     "sched.trace",
+  [CTL_SCHED_INHERIT]   "sched.inherit",
+};
+
+int
+lookup(char *name)
+{
+  for(int id = 0; id < NCTL; id++){
+    if(strcmp(name, names[id]) == 0)
+      return id;
+  }
+  return -1;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int id, val, new;
+  char *eq;
+
+  if(argc == 1){
+    for(id = 0; id < NCTL; id++){
+      if(sysctl(id, &val, 0) == 0)
+        printf("%s = %d\n", names[id], val);
+    }
+    exit(0);
+  }
+
+  for(int i = 1; i < argc; i++){
+    eq = strchr(argv[i], '=');
+    if(eq)
+      *eq = 0;
+    if((id = lookup(argv[i])) < 0){
+      printf("sysctl: unknown parameter %s\n", argv[i]);
+      exit(1);
+    }
+    if(eq){
+      new = atoi(eq + 1);
+      if(sysctl(id, &val, &new) < 0){
+        printf("sysctl: %s: %d is out of range\n", names[id], new);
+        exit(1);
+      }
+      printf("%s: %d -> %d\n", names[id], val, new);
+    } else {
+      sysctl(id, &val, 0);
+      printf("%s = %d\n", names[id], val);
+    }
+  }
+  exit(0);
+}
@@ -2,28 +2,38 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
+#include "kernel/rusage.h"
+
+#define US(cycles) ((int)((cycles) / (TIMEBASE_HZ / 1000000)))
 
 int 
 main(int argc, char ** argv) 
 {
-  int pid = fork();
-  if(pid < 0) {
-    printf("fork(): failed\n");
-    exit(1);
-  } else if(pid == 0) {
-    if(argc == 1) {
+  int pid;
+  if(argc == 1) {
+    pid = fork();
+    if(pid == 0) {
       sleep(10);
       exit(0);
-    } else {
-      exec(argv[1], argv + 1);
-      printf("exec(): failed\n");
-      exit(1);
-    }  
+    }
+  } else {
+    // no need to copy this process only to replace it.
+    pid = spawn(argv[1], argv + 1, 0, 0);
+  }
+  if(pid < 0) {
+    printf(argc == 1 ? "fork(): failed\n" : "spawn(): failed\n");
+    exit(1);
   } else {
     int rtime, wtime;
-    waitx(0, &wtime, &rtime);
+    struct rusage ru;
+    waitx(0, &wtime, &rtime, &ru);
     // similkar to wait
     printf("\nwaiting:%d\nrunning:%d\n", wtime, rtime);
+    printf("in microseconds: running %d, runnable %d, sleeping %d, elapsed %d\n",
+           US(ru.ru_run), US(ru.ru_wait), US(ru.ru_sleep), US(ru.ru_elapsed));
+    printf("scheduled %d times\n", ru.ru_nswitch);
+    printf("copy-on-write faults: %d copied, %d reused\n",
+           ru.ru_cowcopied, ru.ru_cowreused);
   }
   exit(0);
 }
\ No newline at end of file
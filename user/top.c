@@ -0,0 +1,50 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "user/user.h"
+#include "kernel/cpustat.h"
+
+// usage: top [ticks] [count]
+// every ticks ticks (default 10), prints for each online hart
+// how busy it was, how many processes are waiting on its run
+// queue, and how many processes it switched to and pulled
+// over from other harts in that time. stops after count
+// reports (default 10; 0 for no limit).
+
+int
+main(int argc, char *argv[])
+{
+  struct cpustat prev[NCPU], cur[NCPU];
+  int interval = 10, count = 10;
+
+  if(argc > 1)
+    interval = atoi(argv[1]);
+  if(argc > 2)
+    count = atoi(argv[2]);
+  if(interval < 1 || count < 0){
+    printf("usage: top [ticks] [count]\n");
+    exit(1);
+  }
+
+  cpustats(prev);
+  for(int n = 0; count == 0 || n < count; n++){
+    sleep(interval);
+    cpustats(cur);
+    printf("\nhart  busy%%  idle%%  runq  switches  migrated\n");
+    for(int i = 0; i < NCPU; i++){
+      if(!cur[i].online)
+        continue;
+      uint64 elapsed = cur[i].elapsed - prev[i].elapsed;
+      if(elapsed == 0)
+        elapsed = 1;
+      printf("%d     %d     %d     %d     %d     %d\n", i,
+             (int)((cur[i].busy - prev[i].busy) * 100 / elapsed),
+             (int)((cur[i].idle - prev[i].idle) * 100 / elapsed),
+             cur[i].nrunnable,
+             cur[i].nswitch - prev[i].nswitch,
+             cur[i].nmigrated - prev[i].nmigrated);
+    }
+    memmove(prev, cur, sizeof(cur));
+  }
+  exit(0);
+}
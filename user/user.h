@@ -1,11 +1,16 @@
 struct stat;
+struct rusage;
+struct cpustat;
+struct schedev;
+struct kmemstat;
+struct spawnact;
 
 // system calls
 int fork(void);
 int exit(int) __attribute__((noreturn));
 int wait(int*);
 int pipe(int*);
-int waitx(int*, int* /*wtime*/, int* /*rtime*/);
+int waitx(int*, int* /*wtime*/, int* /*rtime*/, struct rusage*);
 int write(int, const void*, int);
 int read(int, void*, int);
 int close(int);
@@ -23,11 +28,25 @@ int getpid(void);
 char* sbrk(int);
 int sleep(int);
 int uptime(void);
-int trace(int);
+int trace(uint64);
 int settickets(int);
 int set_priority(int, int);
 void sigalarm(int, void (*)(void));
 void sigreturn(void);
+int setscheduler(int);
+int sched_setdeadline(int, int, int);
+int getrusage(int, struct rusage*);
+int sysctl(int, int*, int*);
+int sched_setaffinity(int, int);
+int sched_getaffinity(int);
+int cpustats(struct cpustat*);
+int schedtrace(struct schedev*, int);
+int setcpuquota(int, int, int);
+int setcpugroup(int, int);
+int sched_yield(void);
+int yield_to(int);
+int kmemstats(struct kmemstat*);
+int spawn(const char*, char**, struct spawnact*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -7,6 +7,7 @@
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
+#include "kernel/sched.h"
 
 //
 // Tests xv6 system calls.  usertests without arguments runs them all
@@ -822,6 +823,11 @@ preempt(char *s)
   int pid1, pid2, pid3;
   int pfds[2];
 
+  // FCFS and PBS never preempt a spinning process.
+  int policy = setscheduler(-1);
+  if(policy == SCHED_FCFS || policy == SCHED_PBS)
+    return;
+
   pid1 = fork();
   if(pid1 < 0) {
     printf("%s: fork failed", s);
@@ -871,6 +877,84 @@ preempt(char *s)
   wait(0);
 }
 
+// preemption under MLFQ: spinning processes are preempted
+// at every tick, use up their slices and drop levels, and
+// must still run to completion.
+void
+mlfqpreempt(char *s)
+{
+  int old, pid, xstatus;
+  int n = 3;
+
+  old = setscheduler(SCHED_MLFQ);
+  if(old < 0){
+    printf("%s: setscheduler failed\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0){
+      printf("%s: fork failed\n", s);
+      setscheduler(old);
+      exit(1);
+    }
+    if(pid == 0){
+      int end = uptime() + 30;
+      while(uptime() < end)
+        ;
+      exit(0);
+    }
+  }
+  for(int i = 0; i < n; i++){
+    wait(&xstatus);
+    if(xstatus != 0){
+      printf("%s: spinner failed\n", s);
+      setscheduler(old);
+      exit(1);
+    }
+  }
+  setscheduler(old);
+}
+
+// pin a process to each hart in turn. every hart but the one
+// it is on has been idle for a while, with its timer off, so
+// the hart it moves to must be woken up to run it; if it is
+// not, the process is stranded and this hangs.
+void
+pinidle(char *s)
+{
+  int mask, pid, xstatus;
+
+  mask = sched_getaffinity(0);
+  if(mask <= 0){
+    printf("%s: sched_getaffinity failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(int n = 0; n < 3; n++){
+      for(int i = 0; i < NCPU; i++){
+        if(!(mask & (1 << i)))
+          continue;
+        if(sched_setaffinity(0, 1 << i) < 0){
+          printf("%s: sched_setaffinity %d failed\n", s, i);
+          exit(1);
+        }
+        // let the other harts go idle.
+        sleep(2);
+      }
+    }
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(1);
+}
+
 // try to find any races between exit and wait
 void
 exitwait(char *s)
@@ -2595,9 +2679,9 @@ struct test {
   {exectest, "exectest"},
   {pipe1, "pipe1"},
   {killstatus, "killstatus"},
-  #if !defined(FCFS) && !defined(PBS)
   {preempt, "preempt"},
-  #endif
+  {mlfqpreempt, "mlfqpreempt"},
+  {pinidle, "pinidle"},
   {exitwait, "exitwait"},
   {reparent, "reparent" },
   {twochildren, "twochildren"},
@@ -41,4 +41,18 @@ entry("settickets");
 entry("set_priority");
 entry("sigalarm");
 entry("sigreturn");
-entry("waitx")
\ No newline at end of file
+entry("waitx");
+entry("setscheduler");
+entry("sched_setdeadline");
+entry("getrusage");
+entry("sysctl");
+entry("sched_setaffinity");
+entry("sched_getaffinity");
+entry("cpustats");
+entry("schedtrace");
+entry("setcpuquota");
+entry("setcpugroup");
+entry("sched_yield");
+entry("yield_to");
+entry("kmemstats");
+entry("spawn");
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+
+// Directed yield benchmark.
+// usage: yieldbench [nbusy] [ticks]
+//
+// two processes bounce a byte back and forth over two pipes
+// while nbusy cpu-bound processes run next to them, all pinned
+// to one hart. after writing its byte, a process does one of:
+//
+//   read       go straight to read() and block, as schedbench does
+//   sleep      sleep(1) first, the only way to give up the cpu
+//              there used to be
+//   sched_yield  give up the cpu with sched_yield() first
+//   yield_to   hand the cpu to the other process with yield_to()
+//
+// and the number of round trips in the given number of ticks,
+// and the average time each took, are printed for each.
+
+#define NBUSY 4
+#define DURATION 100
+#define US_PER_TICK 100000   // qemu's timer interrupt comes every 1/10th second
+
+enum { READ, SLEEP, YIELD, YIELDTO, NMODE };
+char *modes[NMODE] = { "read", "sleep", "sched_yield", "yield_to" };
+
+void
+handoff(int mode, int peer)
+{
+  if(mode == SLEEP)
+    sleep(1);
+  else if(mode == YIELD)
+    sched_yield();
+  else if(mode == YIELDTO)
+    yield_to(peer);
+}
+
+// bounce bytes until the deadline and report how many round trips.
+void
+ping(int mode, int out, int in, int end, int res)
+{
+  int n = 0, peer, me = getpid();
+
+  // pong learns who to hand the cpu to from the first message.
+  if(write(out, &me, sizeof(me)) != sizeof(me) ||
+     read(in, &peer, sizeof(peer)) != sizeof(peer))
+    exit(1);
+  while(uptime() < end){
+    char c = 'x';
+    if(write(out, &c, 1) != 1)
+      break;
+    handoff(mode, peer);
+    if(read(in, &c, 1) != 1)
+      break;
+    n++;
+  }
+  close(out);
+  write(res, &n, sizeof(n));
+  exit(0);
+}
+
+// echo bytes back until the other side hangs up.
+void
+pong(int mode, int in, int out)
+{
+  int peer, me = getpid();
+  char c;
+
+  if(read(in, &peer, sizeof(peer)) != sizeof(peer) ||
+     write(out, &me, sizeof(me)) != sizeof(me))
+    exit(1);
+  while(read(in, &c, 1) == 1){
+    if(write(out, &c, 1) != 1)
+      break;
+    handoff(mode, peer);
+  }
+  exit(0);
+}
+
+void
+busy(void)
+{
+  volatile int x = 0;
+
+  for(;;)
+    x++;
+}
+
+int
+run(int mode, int nbusy, int duration)
+{
+  int res[2], a[2], b[2], n = 0;
+  int busypids[64];
+
+  if(pipe(res) < 0 || pipe(a) < 0 || pipe(b) < 0){
+    printf("yieldbench: pipe failed\n");
+    exit(1);
+  }
+  for(int i = 0; i < nbusy; i++)
+    if((busypids[i] = fork()) == 0)
+      busy();
+
+  int end = uptime() + duration;
+  if(fork() == 0){
+    close(res[0]);
+    close(a[1]);
+    close(b[0]);
+    pong(mode, a[0], b[1]);
+  }
+  if(fork() == 0){
+    close(res[0]);
+    close(a[0]);
+    close(b[1]);
+    ping(mode, a[1], b[0], end, res[1]);
+  }
+  close(a[0]);
+  close(a[1]);
+  close(b[0]);
+  close(b[1]);
+  close(res[1]);
+  if(read(res[0], &n, sizeof(n)) != sizeof(n))
+    n = 0;
+  close(res[0]);
+
+  for(int i = 0; i < nbusy; i++)
+    if(busypids[i] > 0)
+      kill(busypids[i]);
+  while(wait(0) >= 0)
+    ;
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nbusy = NBUSY, duration = DURATION;
+  int mask = sched_getaffinity(0);
+
+  if(argc > 1)
+    nbusy = atoi(argv[1]);
+  if(argc > 2)
+    duration = atoi(argv[2]);
+  if(nbusy < 0 || nbusy > 64 || duration < 1 || mask <= 0){
+    printf("usage: yieldbench [nbusy] [ticks]\n");
+    exit(1);
+  }
+
+  // everything shares the lowest online hart, so that the
+  // pair has to compete with the busy processes for it.
+  sched_setaffinity(0, mask & -mask);
+
+  printf("%d busy processes, %d ticks\n", nbusy, duration);
+  for(int mode = 0; mode < NMODE; mode++){
+    int n = run(mode, nbusy, duration);
+    if(n > 0)
+      printf("%s: %d round trips, %d us each\n", modes[mode], n,
+             duration * US_PER_TICK / n);
+    else
+      printf("%s: no round trips\n", modes[mode]);
+  }
+  exit(0);
+}